@@ -0,0 +1,405 @@
+/*
+ * bench.c -- end-to-end assembler benchmark
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "asm/lexer.h"
+#include "asm/parser.h"
+#include "asm/unit.h"
+#include "alloc.h"
+#include "ht.h"
+#include "input.h"
+#include "javk-as.h"
+
+
+#define BENCH_REPS 5
+#define JOBS_MAX   1024
+
+enum phase {
+	PHASE_INIT,    // parser_alloc(), lexer_alloc(), unit_alloc()
+	PHASE_SCAN,    // lex_labels(), as -j splits the source
+	PHASE_PARSE,   // lex(), tokenizing and encoding every section
+	PHASE_LINK,    // parser_link() and parser_finish()
+	PHASE_HT_SET,  // ht_set() of every label name
+	PHASE_HT_GET,  // ht_get() of every label name
+	PHASE_COPY,    // parser_copy() into memory
+	PHASE_EMIT,    // parser_emit() to /dev/null
+	PHASE_CNT,
+};
+
+
+static const char *const phases[] = {
+	[PHASE_INIT]   = "init",
+	[PHASE_SCAN]   = "scan",
+	[PHASE_PARSE]  = "parse",
+	[PHASE_LINK]   = "link",
+	[PHASE_HT_SET] = "ht_set",
+	[PHASE_HT_GET] = "ht_get",
+	[PHASE_COPY]   = "copy",
+	[PHASE_EMIT]   = "emit",
+};
+
+static input_t *in;
+static int      devnull = -1;
+static double   best[PHASE_CNT];
+static size_t   instrs;
+static size_t   labels;
+
+// how the label tables were laid out on the last run
+static ht_stats_t names_stats;
+static double     names_probes;  // control groups scanned per lookup
+
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void lap(enum phase phase, double *start)
+{
+	double end = now();
+
+	if (end - *start < best[phase]) best[phase] = end - *start;
+
+	*start = end;
+}
+
+static int ht_phases(const unit_t *unit, double *start)
+{
+	ht_t *ht = ht_alloc(NULL, HT_DEFAULT_HASH, 0);
+	if (!ht) return -1;
+
+	for (size_t i = 0; i < unit->defs_cnt; i++) {
+		const char *key = unit->names + unit->defs[i].name;
+
+		if (ht_set(ht, key, strlen(key) + 1, (void*) key) < 0) goto error;
+	}
+	lap(PHASE_HT_SET, start);
+
+	for (size_t i = 0; i < unit->defs_cnt; i++) {
+		const char *key = unit->names + unit->defs[i].name;
+
+		if (ht_get(ht, key, strlen(key) + 1) != key) goto error;
+	}
+	lap(PHASE_HT_GET, start);
+
+	size_t probes = 0;
+	for (size_t i = 0; i < unit->defs_cnt; i++) {
+		const char *key = unit->names + unit->defs[i].name;
+
+		ht_probe(ht, key, strlen(key) + 1, &probes);
+	}
+
+	ht_stats(ht, &names_stats);
+	names_probes = (unit->defs_cnt) ? (double) probes / unit->defs_cnt : 0.0;
+
+	ht_free(ht, NULL);
+
+	return 0;
+
+error:
+	ht_free(ht, NULL);
+	return -1;
+}
+
+// times each step of a single-threaded assembly on its own
+static int run_phases(void)
+{
+	parser_t     *parser = NULL;
+	lexer_t      *lexer  = NULL;
+	unit_t       *unit   = NULL;
+	uint8_t      *out    = NULL;
+	size_t       *marks  = NULL;
+	size_t        siz    = 0;
+	size_t        cnt    = 0;
+	const unit_t *fail;
+	size_t        line;
+
+	double start = now();
+
+	parser = parser_alloc();
+	lexer  = lexer_alloc();
+	unit   = unit_alloc(false, UNIT_STREAMSIZ);
+	if (!parser || !lexer || !unit) goto error;
+	lap(PHASE_INIT, &start);
+
+	if (lex_labels(in->buf, in->len, &marks, &siz, &cnt) < 0) goto error;
+	lap(PHASE_SCAN, &start);
+
+	if (lex(lexer, unit, in->buf, in->len) < 0) goto error;
+	lap(PHASE_PARSE, &start);
+
+	if (parser_link(parser, unit, &line) < 0) goto error;
+	if (parser_finish(parser, &fail, &line) < 0) goto error;
+	lap(PHASE_LINK, &start);
+
+	start = now();
+
+	if (ht_phases(unit, &start) < 0) goto error;
+
+	out = malloc(parser->size + 1);
+	if (!out) goto error;
+
+	start = now();
+	if (parser_copy(parser, out, parser->size) != parser->size) goto error;
+	lap(PHASE_COPY, &start);
+
+	if (parser_emit(parser, devnull) < 0) goto error;
+	lap(PHASE_EMIT, &start);
+
+	instrs = unit->stream->cnt;
+	labels = unit->defs_cnt;
+
+	free(out);
+	alloc_free(marks);
+	unit_free(unit);
+	lexer_free(lexer);
+	parser_free(parser);
+
+	return 0;
+
+error:
+	free(out);
+	alloc_free(marks);
+	unit_free(unit);
+	lexer_free(lexer);
+	parser_free(parser);
+
+	return -1;
+}
+
+// the whole library path, as javk-as drives it
+static double run_assemble(javk_as_t *as)
+{
+	double start = now();
+
+	if (javk_as_assemble(as, in->buf, in->len) < 0) return -1;
+	if (javk_as_write(as, devnull) < 0) return -1;
+
+	return now() - start;
+}
+
+static void json_string(FILE *stream, const char *str)
+{
+	fputc('"', stream);
+
+	for (; *str; str++) {
+		unsigned char c = *str;
+
+		if (c == '"' || c == '\\') fprintf(stream, "\\%c", c);
+		else if (c < 0x20) fprintf(stream, "\\u%04x", c);
+		else fputc(c, stream);
+	}
+
+	fputc('"', stream);
+}
+
+static void json_hist(FILE *stream, const size_t *hist)
+{
+	size_t last = HT_STATS_HIST;
+	while (last > 1 && !hist[last - 1]) last--;
+
+	fputc('[', stream);
+	for (size_t i = 0; i < last; i++)
+		fprintf(stream, "%s%zu", i ? ", " : "", hist[i]);
+	fputc(']', stream);
+}
+
+static void json_ht(FILE *stream, const char *name, const ht_stats_t *stats)
+{
+	fprintf(stream, ",\n\t\"%s\": {", name);
+	fprintf(stream, "\n\t\t\"entries\": %zu", stats->cnt);
+	fprintf(stream, ",\n\t\t\"capacity\": %zu", stats->cap);
+	fprintf(stream, ",\n\t\t\"load\": %.4f", stats->load);
+	fprintf(stream, ",\n\t\t\"probe_mean\": %.4f", stats->probe_mean);
+	fprintf(stream, ",\n\t\t\"probe_max\": %zu", stats->probe_max);
+	fputs(",\n\t\t\"probe_hist\": ", stream);
+	json_hist(stream, stats->probe_hist);
+	fprintf(stream, ",\n\t\t\"clusters\": %zu", stats->clusters);
+	fprintf(stream, ",\n\t\t\"cluster_max\": %zu", stats->cluster_max);
+	fputs(",\n\t\t\"cluster_hist\": ", stream);
+	json_hist(stream, stats->cluster_hist);
+}
+
+static void report(FILE *stream, const char *path, unsigned jobs, double total)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	fputs("{\n\t\"source\": ", stream);
+	json_string(stream, path);
+	fprintf(stream, ",\n\t\"bytes\": %zu", in->len);
+	fprintf(stream, ",\n\t\"instructions\": %zu", instrs);
+	fprintf(stream, ",\n\t\"labels\": %zu", labels);
+	fprintf(stream, ",\n\t\"jobs\": %u", jobs);
+	fprintf(stream, ",\n\t\"seconds\": %.9f", total);
+	fprintf(stream, ",\n\t\"throughput_mbs\": %.3f", in->len / total / 1e6);
+	fprintf(stream, ",\n\t\"peak_rss_kib\": %ld", usage.ru_maxrss);
+	fputs(",\n\t\"phases\": {", stream);
+
+	for (size_t i = 0; i < PHASE_CNT; i++)
+		fprintf(stream, "%s\n\t\t\"%s\": %.9f", i ? "," : "", phases[i], best[i]);
+
+	fputs("\n\t}", stream);
+
+	json_ht(stream, "names_ht", &names_stats);
+	fprintf(stream, ",\n\t\t\"groups_per_lookup\": %.4f\n\t}", names_probes);
+	fputs("\n}\n", stream);
+}
+
+static void usage(FILE *stream)
+{
+	fputs(
+		"usage: javk-bench [-j jobs] [-r repetitions] input\n"
+		"\n"
+		"  -j, --jobs N           assemble on N threads, 0 for every core (default: 1)\n"
+		"  -r, --repeat N         keep the best of N runs (default: 5)\n"
+		"  -h, --help             show this help\n",
+		stream
+	);
+}
+
+static int parse_count(const char *arg, unsigned max, unsigned *val)
+{
+	char          *end;
+	unsigned long  cnt = strtoul(arg, &end, 10);
+	if (!*arg || *end || cnt > max) return -1;
+
+	*val = cnt;
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{"help",   no_argument,       NULL, 'h'},
+		{"jobs",   required_argument, NULL, 'j'},
+		{"repeat", required_argument, NULL, 'r'},
+		{NULL,     0,                 NULL,  0 },
+	};
+
+	javk_as_t *as    = NULL;
+	unsigned   jobs  = 1;
+	unsigned   reps  = BENCH_REPS;
+	double     total = INFINITY;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "hj:r:", longopts, NULL)) != -1) {
+		switch (opt) {
+			case 'h':
+				usage(stdout);
+				return EXIT_SUCCESS;
+
+			case 'j':
+				if (parse_count(optarg, JOBS_MAX, &jobs) < 0) {
+					fprintf(stderr, "%s: invalid job count\n", optarg);
+					return EXIT_FAILURE;
+				}
+
+				if (!jobs) {
+					long cores = sysconf(_SC_NPROCESSORS_ONLN);
+					jobs = (cores > 0) ? cores : 1;
+				}
+				break;
+
+			case 'r':
+				if (parse_count(optarg, UINT16_MAX, &reps) < 0 || !reps) {
+					fprintf(stderr, "%s: invalid repetitions\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			default:
+				usage(stderr);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind != 1) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	const char *path = argv[optind];
+
+	in = input_open(path);
+	if (!in) {
+		perror(path);
+		goto error;
+	}
+
+	devnull = open("/dev/null", O_WRONLY);
+	if (devnull < 0) {
+		perror("/dev/null");
+		goto error;
+	}
+
+	as = javk_as_alloc();
+	if (!as) goto error;
+
+	javk_as_jobs(as, jobs);
+
+	for (size_t i = 0; i < PHASE_CNT; i++) best[i] = INFINITY;
+
+	for (unsigned i = 0; i < reps; i++) {
+		if (run_phases() < 0) {
+			fprintf(stderr, "%s: failed to assemble\n", path);
+			goto error;
+		}
+
+		double secs = run_assemble(as);
+		if (secs < 0) {
+			fprintf(stderr, "%s:%zu: syntax error\n", path, javk_as_line(as));
+			goto error;
+		}
+
+		if (secs < total) total = secs;
+	}
+
+	report(stdout, path, jobs, total);
+
+	javk_as_free(as);
+	close(devnull);
+	input_close(in);
+
+	return EXIT_SUCCESS;
+
+error:
+	javk_as_free(as);
+	if (devnull >= 0) close(devnull);
+	input_close(in);
+
+	return EXIT_FAILURE;
+}
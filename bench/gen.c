@@ -0,0 +1,265 @@
+/*
+ * gen.c -- synthetic benchmark sources
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define GEN_ADDRMAX 0xffff
+#define GEN_NAMEMAX 255
+#define GEN_JUMPLEN 7    // bytes a jump to a label expands to
+
+// statement mix, in percent
+#define GEN_LDA   20
+#define GEN_NOP   15
+#define GEN_LDI   10
+#define GEN_ARITH 35
+#define GEN_SHIFT 12
+#define GEN_JUMP  5   // to a label, the rest jump through a register
+
+
+static const char *const arith[] = {"ADD", "SUB", "NEG", "AND", "ORR", "EOR"};
+static const char *const wide[]  = {"PC", "SP", "IJ", "KL"};
+
+static const char regs[] = "ABCDEFGHIJKLMNOZ";
+
+static uint64_t state;
+static char     pad[GEN_NAMEMAX + 1];
+
+
+// splitmix64, fixed so a seed always gives the same source
+static uint64_t next(void)
+{
+	uint64_t z = (state += UINT64_C(0x9e3779b97f4a7c15));
+
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+	return z ^ (z >> 31);
+}
+
+static size_t below(size_t n)
+{
+	return next() % n;
+}
+
+static void name(FILE *stream, size_t i, unsigned longpct, unsigned longlen)
+{
+	// long names share a prefix, as namespaced labels tend to
+	if ((i * 2654435761u >> 8) % 100 < longpct)
+		fprintf(stream, "%.*s%08zx", (int) longlen - 8, pad, i);
+	else
+		fprintf(stream, "L%zx", i);
+}
+
+// writes a random statement unless stream is NULL, either way returns the
+// most bytes it can encode to
+static size_t statement(FILE *stream, size_t reach, unsigned longpct, unsigned longlen)
+{
+	unsigned pick = below(100);
+
+	if (pick < GEN_LDA) {
+		char reg = regs[below(15)];
+		if (stream) fprintf(stream, "\tLDA %c\n", reg);
+		return 2;
+	}
+	pick -= GEN_LDA;
+
+	if (pick < GEN_NOP) {
+		if (stream) fputs("\tNOP\n", stream);
+		return 1;
+	}
+	pick -= GEN_NOP;
+
+	if (pick < GEN_LDI) {
+		size_t val = below(256);
+		if (stream) fprintf(stream, "\tLDI %zu\n", val);
+		return 2;
+	}
+	pick -= GEN_LDI;
+
+	if (pick < GEN_ARITH) {
+		const char *op  = arith[below(6)];
+		char        reg = regs[below(16)];
+		if (stream) fprintf(stream, "\t%s %c\n", op, reg);
+		return 1;
+	}
+	pick -= GEN_ARITH;
+
+	if (pick < GEN_SHIFT) {
+		const char *op  = below(2) ? "LSL" : "LSR";
+		size_t      amt = below(8);
+		if (stream) fprintf(stream, "\t%s %zu\n", op, amt);
+		return 1;
+	}
+	pick -= GEN_SHIFT;
+
+	const char *op = below(2) ? "JMP" : "JPL";
+
+	if (pick < GEN_JUMP) {
+		size_t target = below(reach);
+		if (stream) {
+			fprintf(stream, "\t%s ", op);
+			name(stream, target, longpct, longlen);
+			fputc('\n', stream);
+		}
+		return GEN_JUMPLEN;
+	}
+
+	const char *reg = wide[below(4)];
+	if (stream) fprintf(stream, "\t%s %s\n", op, reg);
+	return 1;
+}
+
+// lays out the whole source, returns the labels that start within the
+// 16-bit address space, the only ones a jump can reach
+static size_t layout(FILE *stream, size_t instrs, size_t labels, size_t reach, unsigned longpct, unsigned longlen)
+{
+	// sections come in pairs whose lengths vary but always sum to twice
+	// the average, so the statement count comes out exact
+	size_t avg  = instrs / labels;
+	size_t rem  = instrs % labels;
+	size_t skew = 0;
+	size_t addr = 0;
+	size_t fits = 0;
+
+	for (size_t i = 0; i < labels; i++) {
+		size_t cnt = avg + (i < rem);
+
+		if (i % 2 == 0) {
+			skew = (avg && i + 1 < labels) ? below(avg) : 0;
+			cnt -= skew;
+		} else {
+			cnt += skew;
+		}
+
+		if (addr <= GEN_ADDRMAX) fits = i + 1;
+
+		if (stream) {
+			name(stream, i, longpct, longlen);
+			fputs(":\n", stream);
+		}
+
+		for (size_t j = 0; j < cnt; j++)
+			addr += statement(stream, reach, longpct, longlen);
+	}
+
+	return fits;
+}
+
+static void usage(FILE *stream)
+{
+	fputs(
+		"usage: javk-gen [-i instructions] [-l labels] [-L length] [-p percent]\n"
+		"                [-s seed] output\n"
+		"\n"
+		"  -i N   statements to generate (default: 1000000)\n"
+		"  -l N   labels to spread them over (default: 100000)\n"
+		"  -L N   length of long label names, 9 to 255 (default: 32)\n"
+		"  -p N   percentage of labels with long names (default: 25)\n"
+		"  -s N   random seed (default: 1)\n",
+		stream
+	);
+}
+
+static int parse(const char *arg, unsigned long long max, unsigned long long *val)
+{
+	char *end;
+
+	*val = strtoull(arg, &end, 10);
+
+	return (!*arg || *end || *val > max) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long instrs  = 1000000;
+	unsigned long long labels  = 100000;
+	unsigned long long longlen = 32;
+	unsigned long long longpct = 25;
+	unsigned long long seed    = 1;
+	int                ret     = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "i:l:L:p:s:")) != -1) {
+		switch (opt) {
+			case 'i':
+				ret = parse(optarg, SIZE_MAX, &instrs);
+				break;
+
+			case 'l':
+				ret = parse(optarg, SIZE_MAX, &labels);
+				break;
+
+			case 'L':
+				ret = parse(optarg, GEN_NAMEMAX, &longlen);
+				if (longlen < 9) ret = -1;
+				break;
+
+			case 'p':
+				ret = parse(optarg, 100, &longpct);
+				break;
+
+			case 's':
+				ret = parse(optarg, UINT64_MAX, &seed);
+				break;
+
+			default:
+				ret = -1;
+				break;
+		}
+
+		if (ret < 0) {
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind != 1 || !labels) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	FILE *stream = fopen(argv[optind], "w");
+	if (!stream) {
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < GEN_NAMEMAX; i++) pad[i] = "javk_bench_"[i % 11];
+
+	// a dry run finds the labels jumps may target, the same seed then
+	// makes every other choice again
+	state = seed;
+	size_t reach = layout(NULL, instrs, labels, labels, longpct, longlen);
+
+	state = seed;
+	layout(stream, instrs, labels, reach, longpct, longlen);
+
+	if (fclose(stream)) {
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
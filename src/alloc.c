@@ -0,0 +1,292 @@
+/*
+ * alloc.c -- heap allocation
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "alloc.h"
+#include "alloc_private.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// tracking is a diagnostic build, a single lock keeps it simple
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static alloc_site_t   sites[ALLOC_SITES];
+static alloc_site_t   other = {.file = "other"};  // once sites runs out
+static alloc_subsys_t subsystems[ALLOC_SUBSYSTEMS];
+static size_t         subsystems_cnt;
+static alloc_count_t  total;
+
+static alloc_row_t rows[ALLOC_SITES + 1];
+
+
+int alloc_report(FILE *stream)
+{
+	pthread_mutex_lock(&lock);
+
+	fprintf(
+		stream,
+		"javk-as: %llu KiB peak heap, %llu KiB live, %llu allocations, "
+		"%llu reallocations moving %llu KiB, %llu frees\n",
+		(unsigned long long) total.peak / 1024,
+		(unsigned long long) total.live / 1024,
+		(unsigned long long) total.calls,
+		(unsigned long long) total.reallocs,
+		(unsigned long long) total.churn / 1024,
+		(unsigned long long) total.frees
+	);
+
+	size_t cnt = 0;
+	for (size_t i = 0; i < subsystems_cnt; i++) {
+		strcpy(rows[cnt].name, subsystems[i].name);
+		rows[cnt++].count = &subsystems[i].count;
+	}
+	print(stream, "subsystem", rows, cnt);
+
+	cnt = 0;
+	for (size_t i = 0; i < ALLOC_SITES; i++) {
+		if (!sites[i].file) continue;
+
+		snprintf(
+			rows[cnt].name,
+			sizeof(rows[cnt].name),
+			"%s:%u",
+			basename_of(sites[i].file),
+			sites[i].line
+		);
+		rows[cnt++].count = &sites[i].count;
+	}
+	if (other.count.calls) {
+		strcpy(rows[cnt].name, other.file);
+		rows[cnt++].count = &other.count;
+	}
+	print(stream, "site", rows, cnt);
+
+	pthread_mutex_unlock(&lock);
+
+	return 0;
+}
+
+void *alloc_track_calloc(const char *file, unsigned line, size_t cnt, size_t siz)
+{
+	if (siz && cnt > (SIZE_MAX - sizeof(alloc_hdr_t)) / siz) return NULL;
+
+	alloc_hdr_t *hdr = calloc(1, sizeof(alloc_hdr_t) + cnt * siz);
+	if (!hdr) return NULL;
+
+	pthread_mutex_lock(&lock);
+	void *ptr = track(hdr, site_get(file, line), cnt * siz);
+	pthread_mutex_unlock(&lock);
+
+	return ptr;
+}
+
+void alloc_track_free(void *ptr)
+{
+	if (!ptr) return;
+
+	alloc_hdr_t *hdr = (alloc_hdr_t*) ptr - 1;
+
+	pthread_mutex_lock(&lock);
+	release(hdr->site, hdr->siz);
+	++hdr->site->count.frees;
+	++hdr->site->subsys->count.frees;
+	++total.frees;
+	pthread_mutex_unlock(&lock);
+
+	free(hdr);
+}
+
+void *alloc_track_malloc(const char *file, unsigned line, size_t siz)
+{
+	if (siz > SIZE_MAX - sizeof(alloc_hdr_t)) return NULL;
+
+	alloc_hdr_t *hdr = malloc(sizeof(alloc_hdr_t) + siz);
+	if (!hdr) return NULL;
+
+	pthread_mutex_lock(&lock);
+	void *ptr = track(hdr, site_get(file, line), siz);
+	pthread_mutex_unlock(&lock);
+
+	return ptr;
+}
+
+void *alloc_track_realloc(const char *file, unsigned line, void *ptr, size_t siz)
+{
+	if (!ptr) return alloc_track_malloc(file, line, siz);
+	if (siz > SIZE_MAX - sizeof(alloc_hdr_t)) return NULL;
+
+	alloc_hdr_t  *old     = (alloc_hdr_t*) ptr - 1;
+	size_t        oldsiz  = old->siz;
+	alloc_site_t *oldsite = old->site;
+	uintptr_t     was     = (uintptr_t) old;
+
+	alloc_hdr_t *hdr = realloc(old, sizeof(alloc_hdr_t) + siz);
+	if (!hdr) return NULL;
+
+	pthread_mutex_lock(&lock);
+
+	// the block now belongs to whoever resized it
+	release(oldsite, oldsiz);
+
+	alloc_site_t *site = site_get(file, line);
+	ptr = track(hdr, site, siz);
+
+	alloc_count_t *counts[] = {&site->count, &site->subsys->count, &total};
+	for (size_t i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+		++counts[i]->reallocs;
+		if ((uintptr_t) hdr != was)
+			counts[i]->churn += (oldsiz < siz) ? oldsiz : siz;
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	return ptr;
+}
+
+
+static void account(alloc_site_t *site, size_t siz)
+{
+	alloc_count_t *counts[] = {&site->count, &site->subsys->count, &total};
+
+	for (size_t i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+		++counts[i]->calls;
+		counts[i]->bytes += siz;
+		counts[i]->live  += siz;
+
+		if (counts[i]->live > counts[i]->peak) counts[i]->peak = counts[i]->live;
+	}
+}
+
+static const char *basename_of(const char *file)
+{
+	const char *slash = strrchr(file, '/');
+
+	return (slash) ? slash + 1 : file;
+}
+
+static int compare(const void *a, const void *b)
+{
+	const alloc_row_t *x = a;
+	const alloc_row_t *y = b;
+
+	// heaviest first
+	if (x->count->bytes != y->count->bytes)
+		return (x->count->bytes < y->count->bytes) ? 1 : -1;
+
+	return strcmp(x->name, y->name);
+}
+
+static void print(FILE *stream, const char *what, alloc_row_t *rows, size_t cnt)
+{
+	qsort(rows, cnt, sizeof(*rows), compare);
+
+	fprintf(
+		stream,
+		"javk-as: %-20s %10s %10s %10s %12s %12s %12s\n",
+		what,
+		"calls",
+		"reallocs",
+		"frees",
+		"KiB",
+		"moved KiB",
+		"peak KiB"
+	);
+
+	for (size_t i = 0; i < cnt; i++) {
+		const alloc_count_t *count = rows[i].count;
+
+		fprintf(
+			stream,
+			"javk-as: %-20s %10llu %10llu %10llu %12.1f %12.1f %12.1f\n",
+			rows[i].name,
+			(unsigned long long) count->calls,
+			(unsigned long long) count->reallocs,
+			(unsigned long long) count->frees,
+			count->bytes / 1024.0,
+			count->churn / 1024.0,
+			count->peak / 1024.0
+		);
+	}
+}
+
+static void release(alloc_site_t *site, size_t siz)
+{
+	site->count.live         -= siz;
+	site->subsys->count.live -= siz;
+	total.live               -= siz;
+}
+
+static alloc_site_t *site_get(const char *file, unsigned line)
+{
+	size_t mask = ALLOC_SITES - 1;
+	size_t i    = ((uintptr_t) file >> 4 ^ line * 2654435761u) & mask;
+
+	// file names are string literals, one address per translation unit
+	for (size_t n = 0; n < ALLOC_SITES; n++, i = (i + 1) & mask) {
+		alloc_site_t *site = sites + i;
+
+		if (site->file == file && site->line == line) return site;
+		if (site->file) continue;
+
+		site->file   = file;
+		site->line   = line;
+		site->subsys = subsys_get(file);
+
+		return site;
+	}
+
+	if (!other.subsys) other.subsys = subsys_get(other.file);
+
+	return &other;
+}
+
+static alloc_subsys_t *subsys_get(const char *file)
+{
+	const char *name = basename_of(file);
+	size_t      len  = strcspn(name, ".");
+
+	if (len >= ALLOC_NAMELEN) len = ALLOC_NAMELEN - 1;
+
+	for (size_t i = 0; i < subsystems_cnt; i++) {
+		if (strlen(subsystems[i].name) == len && !memcmp(subsystems[i].name, name, len))
+			return subsystems + i;
+	}
+
+	// the last slot takes everything past the limit
+	if (subsystems_cnt == ALLOC_SUBSYSTEMS) return subsystems + ALLOC_SUBSYSTEMS - 1;
+
+	alloc_subsys_t *subsys = subsystems + subsystems_cnt++;
+	memcpy(subsys->name, name, len);
+
+	return subsys;
+}
+
+static void *track(alloc_hdr_t *hdr, alloc_site_t *site, size_t siz)
+{
+	hdr->siz  = siz;
+	hdr->site = site;
+
+	account(site, siz);
+
+	return hdr + 1;
+}
@@ -0,0 +1,90 @@
+/*
+ * alloc.h -- heap allocation
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ALLOC
+#define JAVK_AS_ALLOC
+
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// every heap allocation in the library goes through these, building with
+// -Dalloc_tracking=true records each one against its call site
+#ifdef JAVK_AS_ALLOC_TRACK
+
+#define ALLOC_SITES 1024  // distinct call sites tracked, a power of two
+
+#define alloc_calloc(cnt, siz)  alloc_track_calloc(__FILE__, __LINE__, (cnt), (siz))
+#define alloc_free(ptr)         alloc_track_free(ptr)
+#define alloc_malloc(siz)       alloc_track_malloc(__FILE__, __LINE__, (siz))
+#define alloc_realloc(ptr, siz) alloc_track_realloc(__FILE__, __LINE__, (ptr), (siz))
+
+int   alloc_report(FILE *stream);
+void *alloc_track_calloc(const char *file, unsigned line, size_t cnt, size_t siz);
+void  alloc_track_free(void *ptr);
+void *alloc_track_malloc(const char *file, unsigned line, size_t siz);
+void *alloc_track_realloc(const char *file, unsigned line, void *ptr, size_t siz);
+
+#else
+
+#define alloc_calloc(cnt, siz)  calloc((cnt), (siz))
+#define alloc_free(ptr)         free(ptr)
+#define alloc_malloc(siz)       malloc(siz)
+#define alloc_realloc(ptr, siz) realloc((ptr), (siz))
+
+#endif /* JAVK_AS_ALLOC_TRACK */
+
+#define ALLOC_MINSIZ 64  // elements alloc_grow() starts a buffer with
+
+// double the capacity *siz of buf until need elements of elsiz fit; returns
+// the resized buffer, or NULL on overflow or failure with buf left as is
+#define alloc_grow(buf, siz, need, elsiz) \
+	alloc_grow_at(__FILE__, __LINE__, (buf), (siz), (need), (elsiz))
+
+
+// the caller's site is kept for tracking
+static inline void *alloc_grow_at(const char *file, unsigned line, void *buf, size_t *siz, size_t need, size_t elsiz)
+{
+	size_t newsiz = (*siz) ? *siz : ALLOC_MINSIZ;
+
+	while (newsiz < need) {
+		if (newsiz * 2 < newsiz) return NULL;
+		newsiz *= 2;
+	}
+
+	if (newsiz > ((size_t) -1) / elsiz) return NULL;
+
+#ifdef JAVK_AS_ALLOC_TRACK
+	void *tmp = alloc_track_realloc(file, line, buf, newsiz * elsiz);
+#else
+	(void) file;
+	(void) line;
+
+	void *tmp = realloc(buf, newsiz * elsiz);
+#endif
+	if (!tmp) return NULL;
+
+	*siz = newsiz;
+
+	return tmp;
+}
+
+
+#endif /* JAVK_AS_ALLOC */
@@ -0,0 +1,81 @@
+/*
+ * alloc_private.h -- heap allocation
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ALLOC_PRIVATE
+#define JAVK_AS_ALLOC_PRIVATE
+
+
+#include "alloc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+#define ALLOC_SUBSYSTEMS 32
+#define ALLOC_NAMELEN    32
+
+
+typedef struct alloc_count_s {
+	uint64_t calls;     // allocations, reallocations included
+	uint64_t reallocs;
+	uint64_t frees;
+	uint64_t bytes;     // requested over every call
+	uint64_t churn;     // copied by reallocations that moved
+	uint64_t live;
+	uint64_t peak;      // most live at once
+} alloc_count_t;
+
+typedef struct alloc_subsys_s {
+	char          name[ALLOC_NAMELEN];  // source file, less directory and extension
+	alloc_count_t count;
+} alloc_subsys_t;
+
+typedef struct alloc_site_s {
+	const char     *file;
+	unsigned        line;
+	alloc_subsys_t *subsys;
+	alloc_count_t   count;
+} alloc_site_t;
+
+typedef struct alloc_row_s {
+	char                 name[ALLOC_NAMELEN + 16];
+	const alloc_count_t *count;
+} alloc_row_t;
+
+// sits in front of every block, keeping it aligned for any type
+typedef union alloc_hdr_u {
+	struct {
+		size_t        siz;
+		alloc_site_t *site;
+	};
+	max_align_t align;
+} alloc_hdr_t;
+
+
+static void            account(alloc_site_t *site, size_t siz);
+static const char     *basename_of(const char *file);
+static int             compare(const void *a, const void *b);
+static void            print(FILE *stream, const char *what, alloc_row_t *rows, size_t cnt);
+static void            release(alloc_site_t *site, size_t siz);
+static alloc_site_t   *site_get(const char *file, unsigned line);
+static alloc_subsys_t *subsys_get(const char *file);
+static void           *track(alloc_hdr_t *hdr, alloc_site_t *site, size_t siz);
+
+
+#endif /* JAVK_AS_ALLOC_PRIVATE */
@@ -0,0 +1,167 @@
+/*
+ * arena.c -- arena allocator
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "arena.h"
+#include "arena_private.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+
+arena_t *arena_alloc(void)
+{
+	arena_t *tmp = alloc_calloc(1, sizeof(arena_t));
+	if (!tmp) return NULL;
+
+	return tmp;
+}
+
+void *arena_calloc(arena_t *arena, size_t nmemb, size_t siz)
+{
+	if (siz && nmemb > SIZE_MAX / siz) return NULL;
+
+	void *tmp = arena_malloc(arena, nmemb * siz);
+	if (!tmp) return NULL;
+
+	memset(tmp, 0, nmemb * siz);
+
+	return tmp;
+}
+
+void arena_free(arena_t *arena)
+{
+	if (!arena) return;
+
+	arena_blk_t *tmp;
+	arena_blk_t *blk = arena->blk;
+	while (blk) {
+		tmp = blk;
+		blk = blk->prev;
+
+		alloc_free(tmp);
+	}
+
+	alloc_free(arena);
+}
+
+void *arena_malloc(arena_t *arena, size_t siz)
+{
+	if (siz > SIZE_MAX - ARENA_HDRSIZ - ARENA_ALIGN) return NULL;
+
+	siz = align(siz);
+
+	arena_blk_t *blk = arena->blk;
+	if (!blk || blk->siz - blk->cnt < siz) {
+		blk = blk_alloc(arena, siz);
+		if (!blk) return NULL;
+	}
+
+	void *tmp = blk_data(blk) + blk->cnt;
+	blk->cnt += siz;
+
+	// oversized allocations get a block of their own
+	if (blk == arena->blk) arena->last = tmp;
+
+	return tmp;
+}
+
+void *arena_realloc(arena_t *arena, void *ptr, size_t oldsiz, size_t siz)
+{
+	if (!ptr) return arena_malloc(arena, siz);
+
+	arena_blk_t *blk = arena->blk;
+
+	// only the latest allocation can grow in place
+	if (ptr == arena->last && siz <= SIZE_MAX - ARENA_ALIGN) {
+		size_t off = (char*) ptr - blk_data(blk);
+
+		if (align(siz) <= blk->siz - off) {
+			blk->cnt = off + align(siz);
+			return ptr;
+		}
+	}
+
+	void *tmp = arena_malloc(arena, siz);
+	if (!tmp) return NULL;
+
+	memcpy(tmp, ptr, (oldsiz < siz) ? oldsiz : siz);
+
+	return tmp;
+}
+
+void arena_reset(arena_t *arena)
+{
+	arena_blk_t *blk = arena->blk;
+	if (!blk) return;
+
+	// keep the current block around for the next round of allocations
+	arena_blk_t *tmp;
+	arena_blk_t *prev = blk->prev;
+	while (prev) {
+		tmp  = prev;
+		prev = prev->prev;
+
+		alloc_free(tmp);
+	}
+
+	blk->prev   = NULL;
+	blk->cnt    = 0;
+	arena->last = NULL;
+}
+
+
+static inline size_t align(size_t siz)
+{
+	return (siz + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static arena_blk_t *blk_alloc(arena_t *arena, size_t siz)
+{
+	size_t blksiz = ARENA_BLKSIZ - ARENA_HDRSIZ;
+	bool   big    = siz > blksiz / 4;
+
+	if (big) blksiz = siz;
+
+	arena_blk_t *tmp = alloc_malloc(ARENA_HDRSIZ + blksiz);
+	if (!tmp) return NULL;
+
+	tmp->cnt = 0;
+	tmp->siz = blksiz;
+
+	// keep filling the current block after an oversized allocation
+	if (big && arena->blk) {
+		tmp->prev        = arena->blk->prev;
+		arena->blk->prev = tmp;
+	} else {
+		tmp->prev   = arena->blk;
+		arena->blk  = tmp;
+		arena->last = NULL;
+	}
+
+	return tmp;
+}
+
+static inline char *blk_data(arena_blk_t *blk)
+{
+	return (char*) blk + ARENA_HDRSIZ;
+}
@@ -0,0 +1,49 @@
+/*
+ * arena.h -- arena allocator
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ARENA
+#define JAVK_AS_ARENA
+
+
+#include <stddef.h>
+
+
+#define ARENA_BLKSIZ (64 * 1024)
+
+
+typedef struct arena_blk_s {
+	struct arena_blk_s *prev;
+	size_t              cnt;
+	size_t              siz;
+} arena_blk_t;
+
+typedef struct arena_s {
+	arena_blk_t *blk;
+	void        *last;  // most recent allocation, can grow in place
+} arena_t;
+
+
+arena_t *arena_alloc(void);
+void    *arena_calloc(arena_t *arena, size_t nmemb, size_t siz);
+void     arena_free(arena_t *arena);
+void    *arena_malloc(arena_t *arena, size_t siz);
+void    *arena_realloc(arena_t *arena, void *ptr, size_t oldsiz, size_t siz);
+void     arena_reset(arena_t *arena);
+
+
+#endif /* JAVK_AS_ARENA */
@@ -1,5 +1,5 @@
 /*
- * dll.h -- doubly linked list
+ * arena_private.h -- arena allocator
  * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
  *
  * This program is free software: you can redistribute it and/or modify
@@ -16,30 +16,22 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#ifndef JAVK_AS_DLL
-#define JAVK_AS_DLL
+#ifndef JAVK_AS_ARENA_PRIVATE
+#define JAVK_AS_ARENA_PRIVATE
 
 
-#include <stddef.h>
+#include "arena.h"
 
+#include <stddef.h>
 
-typedef struct dll_node_s {
-	struct dll_node_s *prev;
-	struct dll_node_s *next;
-	void              *data;
-} dll_node_t;
 
-typedef struct dll_s {
-	dll_node_t *head;
-	dll_node_t *tail;
-	size_t      size;
-} dll_t;
+#define ARENA_ALIGN  (_Alignof(max_align_t))
+#define ARENA_HDRSIZ ((sizeof(arena_blk_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
 
 
-dll_t  *dll_alloc(void);
-size_t  dll_append(dll_t *dll, void *data);
-void    dll_free(dll_t *dll, void (*free_data)(void *ptr));
-size_t  dll_prepend(dll_t *dll, void *data);
+static inline size_t  align(size_t siz);
+static arena_blk_t   *blk_alloc(arena_t *arena, size_t siz);
+static inline char   *blk_data(arena_blk_t *blk);
 
 
-#endif /* JAVK_AS_DLL */
+#endif /* JAVK_AS_ARENA_PRIVATE */
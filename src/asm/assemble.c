@@ -0,0 +1,693 @@
+/*
+ * assemble.c -- embeddable assembler
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "javk-as.h"
+#include "asm/assemble_private.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm/lexer.h"
+#include "asm/parser.h"
+#include "asm/peephole.h"
+#include "asm/store.h"
+#include "asm/unit.h"
+#include "alloc.h"
+#include "ht.h"
+#include "stats.h"
+
+
+javk_as_t *javk_as_alloc(void)
+{
+	javk_as_t *tmp = alloc_calloc(1, sizeof(javk_as_t));
+	if (!tmp) return NULL;
+
+	tmp->parser = parser_alloc();
+	if (!tmp->parser) goto error;
+
+	tmp->jobs = 1;
+
+	return tmp;
+
+error:
+	alloc_free(tmp);
+	return NULL;
+}
+
+int javk_as_assemble(javk_as_t *as, const char *src, size_t len)
+{
+	int ret;
+
+	as->line = 0;
+	as->err  = JAVK_AS_ERROR_NONE;
+	parser_reset(as->parser);
+
+	memset(&as->stats, 0, sizeof(as->stats));
+	memset(&as->counters, 0, sizeof(as->counters));
+	stats_reset();
+	stats_clock(&as->mark);
+
+	ret = (as->cache)
+		? assemble_sections(as, src, len)
+		: assemble_split(as, src, len);
+
+	lap(as, JAVK_AS_PHASE_LINK);
+
+	for (unsigned i = 0; i < as->job_cnt; i++) {
+		stats_add(&as->counters, &as->job[i].counters);
+		memset(&as->job[i].counters, 0, sizeof(as->job[i].counters));
+	}
+	stats_take(&as->counters);
+
+	as->stats.sections         = as->parser->sections;
+	as->stats.instructions     = as->parser->size;
+	as->stats.section_reallocs = as->counters.section_reallocs;
+	as->stats.ht_rehashes      = as->counters.ht_rehashes;
+	as->stats.ht_lookups       = as->counters.ht_lookups;
+	as->stats.ht_probes        = as->counters.ht_probes;
+
+	if (ret < 0) {
+		// failures without a line of their own are all allocations
+		if (!as->err) as->err = JAVK_AS_ERROR_NOMEM;
+		parser_reset(as->parser);
+	}
+
+	return ret;
+}
+
+int javk_as_assemble_to(javk_as_t *as, const char *src, size_t len, uint8_t *out, size_t *outlen)
+{
+	if (javk_as_assemble(as, src, len) < 0) return -1;
+
+	size_t siz = *outlen;
+
+	*outlen = as->parser->size;
+	if (siz < as->parser->size) {
+		as->err = JAVK_AS_ERROR_SIZE;
+		return -1;
+	}
+
+	parser_copy(as->parser, out, siz);
+
+	return 0;
+}
+
+int javk_as_cache_dir(javk_as_t *as, const char *dir)
+{
+	char *tmp = NULL;
+
+	if (dir) {
+		size_t len = strlen(dir) + 1;
+
+		tmp = alloc_malloc(len);
+		if (!tmp) return -1;
+
+		memcpy(tmp, dir, len);
+
+		// the store works a run at a time
+		if (javk_as_incremental(as, true) < 0) {
+			alloc_free(tmp);
+			return -1;
+		}
+	}
+
+	alloc_free(as->store);
+	as->store = tmp;
+
+	return 0;
+}
+
+size_t javk_as_copy(const javk_as_t *as, uint8_t *out, size_t siz)
+{
+	return parser_copy(as->parser, out, siz);
+}
+
+int javk_as_error(const javk_as_t *as)
+{
+	return as->err;
+}
+
+void javk_as_free(javk_as_t *as)
+{
+	if (!as) return;
+
+	for (unsigned i = 0; i < as->job_cnt; i++) {
+		lexer_free(as->job[i].lexer);
+		unit_free(as->job[i].unit);
+	}
+
+	alloc_free(as->job);
+	parser_free(as->parser);
+
+	ht_free(as->cache, cache_free);
+	ht_free(as->stale, cache_free);
+	alloc_free(as->marks);
+	alloc_free(as->secs);
+	alloc_free(as->store);
+
+	alloc_free(as);
+}
+
+int javk_as_incremental(javk_as_t *as, bool on)
+{
+	if (!on) {
+		// the last result is made of cached sections
+		if (as->cache) parser_reset(as->parser);
+
+		ht_free(as->cache, cache_free);
+		ht_free(as->stale, cache_free);
+		as->cache = NULL;
+		as->stale = NULL;
+
+		return 0;
+	}
+
+	if (as->cache) return 0;
+
+	// entries hold their own copy of the text
+	as->cache = ht_alloc(NULL, NULL, HT_NOCOPY);
+	as->stale = ht_alloc(NULL, NULL, HT_NOCOPY);
+	if (!as->cache || !as->stale) {
+		javk_as_incremental(as, false);
+		return -1;
+	}
+
+	return 0;
+}
+
+void javk_as_jobs(javk_as_t *as, unsigned jobs)
+{
+	as->jobs = (jobs) ? jobs : 1;
+}
+
+const char *javk_as_lexer(javk_as_t *as, const char *name)
+{
+	if (!name) return lexer_select(NULL, as->lexer);
+
+	const char *ret = lexer_select(NULL, name);
+	if (!ret) return NULL;
+
+	as->lexer = ret;
+	for (unsigned i = 0; i < as->job_cnt; i++) lexer_select(as->job[i].lexer, ret);
+
+	return ret;
+}
+
+size_t javk_as_line(const javk_as_t *as)
+{
+	return as->line;
+}
+
+int javk_as_memory_report(FILE *stream)
+{
+#ifdef JAVK_AS_ALLOC_TRACK
+	return alloc_report(stream);
+#else
+	(void) stream;
+
+	return -1;
+#endif
+}
+
+void javk_as_optimize(javk_as_t *as, bool on)
+{
+	// cached sections were encoded with the other setting
+	if (as->cache && as->opt != on) {
+		parser_reset(as->parser);
+		ht_clear(as->cache, cache_free);
+		ht_clear(as->stale, cache_free);
+	}
+
+	as->opt = on;
+}
+
+size_t javk_as_size(const javk_as_t *as)
+{
+	return as->parser->size;
+}
+
+void javk_as_stats(const javk_as_t *as, javk_as_stats_t *stats)
+{
+	*stats = as->stats;
+}
+
+const char *javk_as_strerror(int err)
+{
+	static const char *const msgs[JAVK_AS_ERROR_CNT] = {
+		[JAVK_AS_ERROR_NONE]      = "no error",
+		[JAVK_AS_ERROR_NOMEM]     = "out of memory",
+		[JAVK_AS_ERROR_SIZE]      = "output too large",
+		[JAVK_AS_ERROR_SYNTAX]    = "syntax error",
+		[JAVK_AS_ERROR_MNEMONIC]  = "unknown instruction",
+		[JAVK_AS_ERROR_OPERANDS]  = "wrong number of operands",
+		[JAVK_AS_ERROR_REGISTER]  = "invalid register",
+		[JAVK_AS_ERROR_NUMBER]    = "expected a number",
+		[JAVK_AS_ERROR_RANGE]     = "immediate out of range",
+		[JAVK_AS_ERROR_LEAD]      = "instruction before the first label",
+		[JAVK_AS_ERROR_UNDEFINED] = "undefined label",
+		[JAVK_AS_ERROR_REDEFINED] = "label defined twice",
+		[JAVK_AS_ERROR_RESERVED]  = "label named like a register",
+		[JAVK_AS_ERROR_ADDRESS]   = "label address out of range",
+	};
+
+	if (err < 0 || err >= JAVK_AS_ERROR_CNT) return "unknown error";
+
+	return msgs[err];
+}
+
+int javk_as_write(const javk_as_t *as, int fd)
+{
+	return parser_emit(as->parser, fd);
+}
+
+
+static int assemble_sections(javk_as_t *as, const char *src, size_t len)
+{
+	int ret = -1;
+
+	if (lex_labels(src, len, &as->marks, &as->marks_siz, &as->marks_cnt) < 0)
+		return -1;
+
+	group(as, src);
+
+	size_t cnt = as->marks_cnt - 1;
+
+	if (cnt > as->secs_siz) {
+		sec_t *tmp = alloc_realloc(as->secs, cnt * sizeof(sec_t));
+		if (!tmp) return -1;
+
+		as->secs     = tmp;
+		as->secs_siz = cnt;
+	}
+
+	sec_t  *sec  = as->secs;
+	size_t  miss = 0;
+
+	// sections whose text was seen last time keep their encoding
+	for (size_t i = 0; i < cnt; i++) {
+		const char *text = src + as->marks[i];
+		size_t      siz  = as->marks[i + 1] - as->marks[i];
+
+		sec[i].text  = text;
+		sec[i].len   = siz;
+		sec[i].fresh = false;
+
+		cache_ent_t *ent = ht_get(as->cache, text, siz);
+		if (!ent) {
+			ent = ht_del(as->stale, text, siz);
+			if (ent && ht_set(as->cache, ent->text, ent->len, ent) < 0) {
+				cache_free(ent);
+				ent = NULL;
+			}
+		}
+
+		sec[i].unit = (ent) ? ent->unit : NULL;
+		if (!ent) miss += siz;
+	}
+
+	unsigned jobs = as->jobs;
+	if (jobs > miss / ASSEMBLE_MINLEN + 1) jobs = miss / ASSEMBLE_MINLEN + 1;
+
+	if (job_prepare(as, jobs) < 0) goto error;
+
+	// hand out the missing sections in even runs of source
+	job_t  *job  = as->job;
+	size_t  i    = 0;
+	size_t  done = 0;
+	for (unsigned j = 0; j < jobs; j++) {
+		job[j].as    = as;
+		job[j].src   = src;
+		job[j].first = i;
+
+		while (i < cnt && (j + 1 == jobs || done < miss / jobs * (j + 1))) {
+			if (!sec[i].unit) done += as->marks[i + 1] - as->marks[i];
+			++i;
+		}
+
+		job[j].last = i;
+	}
+
+	lap(as, JAVK_AS_PHASE_SCAN);
+
+	run(job, jobs);
+	lap(as, JAVK_AS_PHASE_PARSE);
+
+	// keep what encoded cleanly, whatever happens next
+	for (unsigned j = 0; j < jobs; j++) {
+		for (i = job[j].first; i < job[j].last; i++) {
+			if (!sec[i].fresh) continue;
+
+			if (job[j].ret < 0 && i >= job[j].fail) continue;
+			if (cache_put(as, sec + i) < 0) goto error;
+		}
+	}
+
+	for (unsigned j = 0; j < jobs; j++) {
+		if (job[j].ret < 0) {
+			const lexer_t *lexer = job[j].lexer;
+
+			report(as, lexer->err, src, as->marks[job[j].fail], lexer->line);
+			goto error;
+		}
+	}
+
+	const unit_t *unit;
+	size_t        line;
+
+	for (i = 0; i < cnt; i++) {
+		if (parser_link(as->parser, sec[i].unit, &line) < 0) {
+			report(as, as->parser->err, src, as->marks[i], line);
+			goto error;
+		}
+	}
+
+	if (parser_finish(as->parser, &unit, &line) < 0) {
+		for (i = 0; i < cnt && sec[i].unit != unit; i++);
+
+		report(as, JAVK_AS_ERROR_UNDEFINED, src, as->marks[i], line);
+		goto error;
+	}
+
+	ret = 0;
+
+error:
+	// sections that failed or never made it into the cache
+	for (i = 0; i < cnt; i++) {
+		if (!sec[i].fresh) continue;
+
+		unit_free(sec[i].unit);
+		sec[i].unit  = NULL;
+		sec[i].fresh = false;
+	}
+
+	// anything not reused this time is dropped, the rest is kept for next time
+	ht_t *tmp = as->stale;
+
+	ht_clear(tmp, cache_free);
+	as->stale = as->cache;
+	as->cache = tmp;
+
+	return ret;
+}
+
+static int assemble_split(javk_as_t *as, const char *src, size_t len)
+{
+	unsigned jobs = as->jobs;
+
+	if (jobs > len / ASSEMBLE_MINLEN + 1) jobs = len / ASSEMBLE_MINLEN + 1;
+
+	if (job_prepare(as, jobs) < 0) return -1;
+
+	job_t *job = as->job;
+
+	split(job, jobs, src, len);
+	lap(as, JAVK_AS_PHASE_SCAN);
+
+	run(job, jobs);
+	lap(as, JAVK_AS_PHASE_PARSE);
+
+	const unit_t *unit;
+	size_t        line;
+
+	// link in source order so the output never depends on scheduling
+	for (unsigned i = 0; i < jobs; i++) {
+		const lexer_t *lexer = job[i].lexer;
+
+		if (job[i].ret < 0) {
+			report(as, lexer->err, src, job[i].buf - src, lexer->line);
+			return -1;
+		}
+
+		if (parser_link(as->parser, job[i].unit, &line) < 0) {
+			report(as, as->parser->err, src, job[i].buf - src, line);
+			return -1;
+		}
+	}
+
+	if (parser_finish(as->parser, &unit, &line) < 0) {
+		for (unsigned i = 0; i < jobs; i++) {
+			if (job[i].unit != unit) continue;
+
+			report(as, JAVK_AS_ERROR_UNDEFINED, src, job[i].buf - src, line);
+		}
+
+		return -1;
+	}
+
+	return 0;
+}
+
+static void cache_free(void *ptr)
+{
+	cache_ent_t *ent = ptr;
+
+	unit_free(ent->unit);
+	alloc_free(ent);
+}
+
+static int cache_put(javk_as_t *as, sec_t *sec)
+{
+	cache_ent_t *ent = ht_get(as->cache, sec->text, sec->len);
+
+	// the same text twice in one source is kept once
+	if (ent) {
+		unit_free(sec->unit);
+		sec->unit  = ent->unit;
+		sec->fresh = false;
+		return 0;
+	}
+
+	ent = alloc_malloc(sizeof(cache_ent_t) + sec->len);
+	if (!ent) return -1;
+
+	ent->unit = sec->unit;
+	ent->len  = sec->len;
+	memcpy(ent->text, sec->text, sec->len);
+
+	if (ht_set(as->cache, ent->text, ent->len, ent) < 0) {
+		alloc_free(ent);
+		return -1;
+	}
+
+	// the cache owns the unit from here on
+	sec->fresh = false;
+
+	return 0;
+}
+
+static size_t count_lines(const char *buf, size_t len)
+{
+	const char *pos = buf;
+	const char *end = buf + len;
+	size_t      cnt = 0;
+
+	while ((pos = memchr(pos, '\n', end - pos))) {
+		++pos;
+		++cnt;
+	}
+
+	return cnt;
+}
+
+static void group(javk_as_t *as, const char *src)
+{
+	size_t *marks = as->marks;
+	size_t  cnt   = 1;
+
+	// cut only where the label itself says so, then an edit moves at most
+	// the cuts around it and every other group keeps its text
+	for (size_t i = 1; i + 1 < as->marks_cnt; i++) {
+		size_t run = marks[i] - marks[cnt - 1];
+		size_t key = marks[i + 1] - marks[i];
+
+		if (key > ASSEMBLE_KEYLEN) key = ASSEMBLE_KEYLEN;
+
+		if (run < ASSEMBLE_GROUPMIN) continue;
+		if (run < ASSEMBLE_GROUPMAX
+			&& ht_hash_wy(src + marks[i], key, 0) % ASSEMBLE_GROUPAVG)
+			continue;
+
+		marks[cnt++] = marks[i];
+	}
+
+	marks[cnt++] = marks[as->marks_cnt - 1];
+
+	as->marks_cnt = cnt;
+}
+
+static int job_prepare(javk_as_t *as, unsigned cnt)
+{
+	if (cnt > as->job_cnt) {
+		job_t *tmp = alloc_realloc(as->job, cnt * sizeof(job_t));
+		if (!tmp) return -1;
+
+		memset(tmp + as->job_cnt, 0, (cnt - as->job_cnt) * sizeof(job_t));
+
+		as->job = tmp;
+	}
+
+	// scratch from earlier assemblies is reused as-is
+	for (; as->job_cnt < cnt; as->job_cnt++) {
+		job_t *job = as->job + as->job_cnt;
+
+		job->lexer = lexer_alloc();
+		if (!job->lexer) return -1;
+
+		lexer_select(job->lexer, as->lexer);
+
+		job->unit = unit_alloc(as->job_cnt > 0, UNIT_STREAMSIZ);
+		if (!job->unit) {
+			lexer_free(job->lexer);
+			job->lexer = NULL;
+			return -1;
+		}
+	}
+
+	for (unsigned i = 0; i < cnt; i++) {
+		unit_reset(as->job[i].unit);
+		as->job[i].as      = NULL;
+		as->job[i].opt     = as->opt;
+		as->job[i].spawned = false;
+	}
+
+	return 0;
+}
+
+static void *job_run(void *arg)
+{
+	job_t *job = arg;
+
+	if (!job->as) {
+		job->ret = lex(job->lexer, job->unit, job->buf, job->len);
+		if (!job->ret && job->opt) peephole(job->unit);
+
+		return NULL;
+	}
+
+	const size_t *marks = job->as->marks;
+	sec_t        *sec   = job->as->secs;
+	const char   *store = job->as->store;
+
+	// every run is its own unit so it can be cached on its own
+	job->ret = 0;
+	for (job->fail = job->first; job->fail < job->last; job->fail++) {
+		size_t i = job->fail;
+		if (sec[i].unit) continue;
+
+		sec[i].unit = unit_alloc(false, UNIT_SECSIZ);
+		if (!sec[i].unit) {
+			job->lexer->line = 0;
+			job->lexer->err  = JAVK_AS_ERROR_NOMEM;
+			job->ret = -1;
+			return NULL;
+		}
+
+		sec[i].fresh = true;
+
+		const char *text = job->src + marks[i];
+		size_t      siz  = marks[i + 1] - marks[i];
+
+		if (store && !store_get(store, text, siz, job->opt, sec[i].unit))
+			continue;
+
+		job->ret = lex(job->lexer, sec[i].unit, text, siz);
+		if (job->ret < 0) return NULL;
+
+		if (job->opt) peephole(sec[i].unit);
+
+		// a store that cannot be written to only costs the next run
+		if (store) store_put(store, text, siz, job->opt, sec[i].unit);
+	}
+
+	return NULL;
+}
+
+static void *job_thread(void *arg)
+{
+	job_t *job = arg;
+
+	job_run(job);
+
+	// the thread's counters go with it
+	stats_take(&job->counters);
+
+	return NULL;
+}
+
+static void lap(javk_as_t *as, enum javk_as_phase phase)
+{
+	stats_clock_t now;
+
+	stats_clock(&now);
+
+	as->stats.wall[phase] += now.wall - as->mark.wall;
+	as->stats.cpu[phase]  += now.cpu - as->mark.cpu;
+
+	as->mark = now;
+}
+
+static void report(javk_as_t *as, int err, const char *src, size_t mark, size_t line)
+{
+	as->err = err;
+
+	// line counts from mark, 0 when the failure has no line of its own
+	as->line = (line) ? count_lines(src, mark) + line : 0;
+}
+
+static void run(job_t *jobs, unsigned cnt)
+{
+	for (unsigned i = 1; i < cnt; i++)
+		jobs[i].spawned = !pthread_create(&jobs[i].thread, NULL, job_thread, jobs + i);
+
+	// the calling thread takes the first job and any that failed to spawn
+	for (unsigned i = 0; i < cnt; i++)
+		if (!jobs[i].spawned) job_run(jobs + i);
+
+	for (unsigned i = 1; i < cnt; i++)
+		if (jobs[i].spawned) pthread_join(jobs[i].thread, NULL);
+}
+
+static void split(job_t *jobs, unsigned cnt, const char *buf, size_t len)
+{
+	const char *pos = buf;
+	const char *end = buf + len;
+
+	// cut after a newline so no line straddles two jobs
+	for (unsigned i = 0; i < cnt; i++) {
+		const char *cut = end;
+
+		if (i + 1 < cnt && (size_t) (end - pos) > len / cnt) {
+			cut = memchr(pos + len / cnt, '\n', end - pos - len / cnt);
+			cut = (cut) ? cut + 1 : end;
+
+			// LDI and the peephole pass start afresh at a label, so
+			// only cut there for the result not to depend on the jobs
+			cut = lex_next_label(cut, end);
+		}
+
+		jobs[i].buf = pos;
+		jobs[i].len = cut - pos;
+
+		pos = cut;
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * assemble_private.h -- embeddable assembler
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_ASSEMBLE_PRIVATE
+#define JAVK_AS_ASM_ASSEMBLE_PRIVATE
+
+
+#include "javk-as.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm/lexer.h"
+#include "asm/parser.h"
+#include "asm/unit.h"
+#include "ht.h"
+#include "stats.h"
+
+
+#define ASSEMBLE_MINLEN (256 * 1024)  // smallest stretch worth a thread
+
+// incremental assemblies cache runs of sections rather than single ones
+#define ASSEMBLE_GROUPMIN (4 * 1024)   // bytes of source
+#define ASSEMBLE_GROUPMAX (64 * 1024)
+#define ASSEMBLE_GROUPAVG 32           // sections past the minimum
+#define ASSEMBLE_KEYLEN   32           // label bytes deciding a cut
+
+
+// keyed on a copy of the text itself, so a hit is always exact
+typedef struct cache_ent_s {
+	unit_t *unit;
+	size_t  len;
+	char    text[];
+} cache_ent_t;
+
+typedef struct sec_s {
+	unit_t     *unit;
+	const char *text;   // in the source being assembled
+	size_t      len;
+	bool        fresh;  // encoded by this assembly, not yet cached
+} sec_t;
+
+typedef struct job_s {
+	const char *buf;
+	size_t      len;
+	lexer_t    *lexer;
+	unit_t     *unit;
+	int         ret;
+	pthread_t   thread;
+	bool        spawned;
+	bool        opt;    // run the peephole pass over what was encoded
+
+	// incremental assemblies encode whole sections instead of buf
+	javk_as_t  *as;
+	const char *src;
+	size_t      first;
+	size_t      last;
+	size_t      fail;   // section that failed to encode
+
+	stats_t     counters;  // of the thread the job ran on, if spawned
+} job_t;
+
+struct javk_as_s {
+	parser_t *parser;
+	job_t    *job;      // scratch kept between assemblies
+	unsigned  job_cnt;
+	unsigned  jobs;     // requested parallelism
+	size_t    line;     // line of the last error
+	int       err;      // why the last assembly failed
+	bool      opt;      // peephole pass requested
+
+	const char *lexer;  // classifier of every job, NULL for the fastest
+
+	ht_t     *cache;    // sections used by this assembly, by text
+	ht_t     *stale;    // sections used by the previous one
+	sec_t    *secs;
+	size_t    secs_siz;
+	size_t   *marks;    // section offsets, ending with the source length
+	size_t    marks_cnt;
+	size_t    marks_siz;
+	char     *store;    // on-disk section store, if any
+
+	javk_as_stats_t stats;
+	stats_t         counters;
+	stats_clock_t   mark;  // end of the last phase timed
+};
+
+
+static int    assemble_sections(javk_as_t *as, const char *src, size_t len);
+static int    assemble_split(javk_as_t *as, const char *src, size_t len);
+static void   cache_free(void *ptr);
+static int    cache_put(javk_as_t *as, sec_t *sec);
+static size_t count_lines(const char *buf, size_t len);
+static void   group(javk_as_t *as, const char *src);
+static int    job_prepare(javk_as_t *as, unsigned cnt);
+static void  *job_run(void *arg);
+static void  *job_thread(void *arg);
+static void   lap(javk_as_t *as, enum javk_as_phase phase);
+static void   report(javk_as_t *as, int err, const char *src, size_t mark, size_t line);
+static void   run(job_t *jobs, unsigned cnt);
+static void   split(job_t *jobs, unsigned cnt, const char *buf, size_t len);
+
+
+#endif /* JAVK_AS_ASM_ASSEMBLE_PRIVATE */
@@ -0,0 +1,589 @@
+/*
+ * lexer.c -- source lexing
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "asm/lexer.h"
+#include "asm/lexer_private.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm/parser.h"
+#include "asm/unit.h"
+#include "alloc.h"
+#include "javk-as.h"
+
+#ifdef LEXER_X86
+#include <immintrin.h>
+#endif
+
+
+static const lexer_impl_t impl_scalar = {
+	.name     = "scalar",
+	.classify = classify_scalar,
+};
+
+#ifdef LEXER_X86
+static const lexer_impl_t impl_sse2 = {
+	.name     = "sse2",
+	.classify = classify_sse2,
+};
+
+static const lexer_impl_t impl_avx2 = {
+	.name     = "avx2",
+	.classify = classify_avx2,
+};
+#endif
+
+// the fastest classifier, settled once for the whole process
+static const lexer_impl_t *impl_auto = &impl_scalar;
+
+
+int lex(lexer_t *lex, unit_t *unit, const char *buf, size_t len)
+{
+	const char *pos  = buf;
+	const char *end  = buf + len;
+	const char *tok;
+	bool        open = false;
+
+	lex->unit      = unit;
+	lex->end       = end;
+	lex->name      = LEXER_NONE;
+	lex->line      = 0;
+	lex->secline   = 0;
+	lex->err       = JAVK_AS_ERROR_NONE;
+	lex->str_cnt   = 0;
+	lex->off_cnt   = 0;
+	lex->lines_cnt = 0;
+
+	load(lex, pos);
+
+	while (pos < end) {
+		++lex->line;
+
+		pos = skip_blank(lex, pos);
+		tok = pos;
+		pos = find_delim(lex, pos);
+
+		if (pos < end && *pos == ':') {
+			if (tok == pos) return fail(lex, JAVK_AS_ERROR_SYNTAX);
+
+			// a jump to it would take the register instead
+			if (parser_is_register(tok, pos - tok))
+				return fail(lex, JAVK_AS_ERROR_RESERVED);
+
+			if (open && lexer_flush(lex) < 0) return -1;
+			open = true;
+
+			lex->secline = lex->line;
+			if (push_token(lex, tok, pos - tok, TOKEN_NAME) < 0)
+				return fail(lex, JAVK_AS_ERROR_NOMEM);
+
+			// an instruction may follow the label
+			pos = skip_blank(lex, pos + 1);
+			tok = pos;
+			pos = find_delim(lex, pos);
+		}
+
+		if (tok < pos) {
+			if (!open) {
+				// only a continuation may start mid-section
+				if (!unit->cont) return fail(lex, JAVK_AS_ERROR_LEAD);
+
+				open         = true;
+				lex->secline = lex->line;
+			}
+
+			enum token_kind kind = TOKEN_MNEMONIC;
+			do {
+				if (push_token(lex, tok, pos - tok, kind) < 0)
+					return fail(lex, JAVK_AS_ERROR_NOMEM);
+
+				kind = TOKEN_OPERAND;
+
+				pos = skip_blank(lex, pos);
+				tok = pos;
+				pos = find_delim(lex, pos);
+			} while (tok < pos);
+
+			if (push_eol(lex) < 0) return fail(lex, JAVK_AS_ERROR_NOMEM);
+		}
+
+		if (pos < end && *pos == ':') return fail(lex, JAVK_AS_ERROR_SYNTAX);
+		if (pos < end && *pos == ';') pos = find_eol(pos, end);
+		if (pos < end) ++pos;
+	}
+
+	if (open && lexer_flush(lex) < 0) return -1;
+
+	return 0;
+}
+
+int lex_labels(const char *buf, size_t len, size_t **marks, size_t *siz, size_t *cnt)
+{
+	const char *pos = buf;
+	const char *end = buf + len;
+
+	*cnt = 0;
+
+	// the first section starts at the top even without a label
+	if (push_mark(marks, siz, cnt, 0) < 0) return -1;
+
+	for (;;) {
+		pos = find_eol(pos, end);
+		if (pos < end) ++pos;
+
+		pos = lex_next_label(pos, end);
+		if (pos == end) break;
+
+		if (push_mark(marks, siz, cnt, pos - buf) < 0) return -1;
+	}
+
+	return push_mark(marks, siz, cnt, len);
+}
+
+const char *lex_next_label(const char *pos, const char *end)
+{
+	const char *tok;
+
+	// pos is expected at the start of a line
+	while (pos < end) {
+		const char *bol = pos;
+
+		while (pos < end && is_blank(*pos)) ++pos;
+		for (tok = pos; pos < end && !is_delim(*pos); ++pos);
+
+		if (pos < end && *pos == ':' && tok < pos) return bol;
+
+		pos = find_eol(pos, end);
+		if (pos < end) ++pos;
+	}
+
+	return end;
+}
+
+lexer_t *lexer_alloc(void)
+{
+	lexer_t *tmp = alloc_calloc(1, sizeof(lexer_t));
+	if (!tmp) return NULL;
+
+	lexer_select(tmp, NULL);
+
+	return tmp;
+}
+
+void lexer_free(lexer_t *lex)
+{
+	if (!lex) return;
+
+	alloc_free(lex->str);
+	alloc_free(lex->off);
+	alloc_free(lex->tokv);
+	alloc_free(lex->lines);
+
+	alloc_free(lex);
+}
+
+const char *lexer_select(lexer_t *lex, const char *name)
+{
+	static const lexer_impl_t *const impls[] = {
+#ifdef LEXER_X86
+		&impl_avx2,
+		&impl_sse2,
+#endif
+		&impl_scalar,
+	};
+
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	// any number of contexts may ask for the default at once
+	pthread_once(&once, select_auto);
+
+	const lexer_impl_t *impl = impl_auto;
+
+	if (name) {
+		size_t cnt = sizeof(impls) / sizeof(*impls);
+		size_t i   = 0;
+
+		while (i < cnt && strcmp(name, impls[i]->name)) i++;
+		if (i == cnt) return NULL;
+
+#ifdef LEXER_X86
+		if (impls[i] == &impl_avx2 && !__builtin_cpu_supports("avx2"))
+			return NULL;
+#endif
+
+		impl = impls[i];
+	}
+
+	if (lex) lex->impl = impl;
+
+	return impl->name;
+}
+
+
+static void select_auto(void)
+{
+#ifdef LEXER_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) impl_auto = &impl_avx2;
+	else impl_auto = &impl_sse2;
+#endif
+}
+
+
+static inline bool is_blank(char c)
+{
+	// every control byte but '\n' separates tokens, as does ','
+	return ((unsigned char) c <= ' ' && c != '\n') || c == ',';
+}
+
+static inline bool is_delim(char c)
+{
+	return (unsigned char) c <= ' ' || c == ',' || c == ';' || c == ':';
+}
+
+static void classify_scalar(const char *pos, size_t len, uint64_t *delim, uint64_t *blank)
+{
+	// anything past the end reads as a non-blank delimiter
+	uint64_t d = (len < LEXER_BLKSIZ) ? ~UINT64_C(0) << len : 0;
+	uint64_t b = 0;
+
+	for (size_t i = 0; i < len && i < LEXER_BLKSIZ; i++) {
+		d |= (uint64_t) is_delim(pos[i]) << i;
+		b |= (uint64_t) is_blank(pos[i]) << i;
+	}
+
+	*delim = d;
+	*blank = b;
+}
+
+
+#ifdef LEXER_X86
+static inline __m128i blank_sse2(__m128i x)
+{
+	__m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(' ')), x);
+	__m128i eol = _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'));
+	__m128i sep = _mm_cmpeq_epi8(x, _mm_set1_epi8(','));
+
+	return _mm_or_si128(_mm_andnot_si128(eol, ctl), sep);
+}
+
+static inline __m128i delim_sse2(__m128i x)
+{
+	__m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(' ')), x);
+	__m128i sep = _mm_cmpeq_epi8(x, _mm_set1_epi8(','));
+	__m128i com = _mm_cmpeq_epi8(x, _mm_set1_epi8(';'));
+	__m128i lbl = _mm_cmpeq_epi8(x, _mm_set1_epi8(':'));
+
+	return _mm_or_si128(_mm_or_si128(ctl, sep), _mm_or_si128(com, lbl));
+}
+
+static void classify_sse2(const char *pos, size_t len, uint64_t *delim, uint64_t *blank)
+{
+	if (len < LEXER_BLKSIZ) {
+		classify_scalar(pos, len, delim, blank);
+		return;
+	}
+
+	uint64_t d = 0;
+	uint64_t b = 0;
+
+	for (unsigned i = 0; i < LEXER_BLKSIZ; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (pos + i));
+
+		d |= (uint64_t) (uint16_t) _mm_movemask_epi8(delim_sse2(x)) << i;
+		b |= (uint64_t) (uint16_t) _mm_movemask_epi8(blank_sse2(x)) << i;
+	}
+
+	*delim = d;
+	*blank = b;
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i blank_avx2(__m256i x)
+{
+	__m256i ctl = _mm256_cmpeq_epi8(
+		_mm256_min_epu8(x, _mm256_set1_epi8(' ')),
+		x
+	);
+	__m256i eol = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'));
+	__m256i sep = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(','));
+
+	return _mm256_or_si256(_mm256_andnot_si256(eol, ctl), sep);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i delim_avx2(__m256i x)
+{
+	__m256i ctl = _mm256_cmpeq_epi8(
+		_mm256_min_epu8(x, _mm256_set1_epi8(' ')),
+		x
+	);
+	__m256i sep = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(','));
+	__m256i com = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(';'));
+	__m256i lbl = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(':'));
+
+	return _mm256_or_si256(
+		_mm256_or_si256(ctl, sep),
+		_mm256_or_si256(com, lbl)
+	);
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char *pos, size_t len, uint64_t *delim, uint64_t *blank)
+{
+	if (len < LEXER_BLKSIZ) {
+		classify_scalar(pos, len, delim, blank);
+		return;
+	}
+
+	__m256i lo = _mm256_loadu_si256((const __m256i*) pos);
+	__m256i hi = _mm256_loadu_si256((const __m256i*) (pos + 32));
+
+	*delim = (uint64_t) (uint32_t) _mm256_movemask_epi8(delim_avx2(lo))
+		| (uint64_t) (uint32_t) _mm256_movemask_epi8(delim_avx2(hi)) << 32;
+	*blank = (uint64_t) (uint32_t) _mm256_movemask_epi8(blank_avx2(lo))
+		| (uint64_t) (uint32_t) _mm256_movemask_epi8(blank_avx2(hi)) << 32;
+}
+#endif /* LEXER_X86 */
+
+
+static inline void load(lexer_t *lex, const char *pos)
+{
+	lex->blk = pos;
+	lex->impl->classify(pos, lex->end - pos, &lex->delim, &lex->blank);
+}
+
+static inline const char *find_delim(lexer_t *lex, const char *pos)
+{
+	for (;;) {
+		size_t off = pos - lex->blk;
+
+		if (off >= LEXER_BLKSIZ) {
+			load(lex, pos);
+			off = 0;
+		}
+
+		uint64_t mask = lex->delim >> off;
+		if (mask) return pos + __builtin_ctzll(mask);
+
+		pos = lex->blk + LEXER_BLKSIZ;
+	}
+}
+
+static const char *find_eol(const char *pos, const char *end)
+{
+	const char *tmp = memchr(pos, '\n', end - pos);
+
+	return (tmp) ? tmp : end;
+}
+
+static inline void fold(char *dst, const char *src, size_t len, const char *end)
+{
+#ifdef LEXER_X86
+	// mnemonics and registers fit in a single vector
+	if (len <= 16 && end - src >= 16) {
+		__m128i x     = _mm_loadu_si128((const __m128i*) src);
+		__m128i off   = _mm_sub_epi8(x, _mm_set1_epi8('a'));
+		__m128i lower = _mm_cmpeq_epi8(
+			_mm_min_epu8(off, _mm_set1_epi8('z' - 'a')),
+			off
+		);
+
+		x = _mm_sub_epi8(x, _mm_and_si128(lower, _mm_set1_epi8(0x20)));
+		_mm_storeu_si128((__m128i*) dst, x);
+
+		return;
+	}
+#else
+	(void) end;
+#endif
+
+	for (size_t i = 0; i < len; i++)
+		dst[i] = (src[i] >= 'a' && src[i] <= 'z') ? src[i] - 0x20 : src[i];
+}
+
+static inline const char *skip_blank(lexer_t *lex, const char *pos)
+{
+	for (;;) {
+		size_t off = pos - lex->blk;
+
+		if (off >= LEXER_BLKSIZ) {
+			load(lex, pos);
+			off = 0;
+		}
+
+		uint64_t mask = ~lex->blank >> off;
+		if (mask) return pos + __builtin_ctzll(mask);
+
+		pos = lex->blk + LEXER_BLKSIZ;
+	}
+}
+
+
+static int fail(lexer_t *lex, int err)
+{
+	lex->err = err;
+	return -1;
+}
+
+static int lexer_flush(lexer_t *lex)
+{
+	unit_t *unit = lex->unit;
+	size_t  off  = unit->stream->cnt;
+	int     ret  = 0;
+
+	// the token text is final, so offsets can become pointers
+	if (lex->off_cnt > lex->tokv_siz) {
+		const char **tmp = alloc_grow(
+			lex->tokv,
+			&lex->tokv_siz,
+			lex->off_cnt,
+			sizeof(*lex->tokv)
+		);
+		if (!tmp) return fail(lex, JAVK_AS_ERROR_NOMEM);
+
+		lex->tokv = tmp;
+	}
+
+	for (size_t i = 0; i < lex->off_cnt; i++) {
+		lex->tokv[i] = (lex->off[i] == LEXER_NONE)
+			? NULL
+			: lex->str + lex->off[i];
+	}
+
+	if (lex->name == LEXER_NONE) {
+		unit->line = lex->secline;
+	} else if (unit_define(unit, lex->str + lex->name, off, lex->secline) < 0) {
+		lex->line = lex->secline;
+		ret = fail(lex, JAVK_AS_ERROR_NOMEM);
+	}
+
+	// each statement runs up to the NULL ending its line
+	const char **tokens = lex->tokv;
+	for (size_t i = 0; !ret && i < lex->lines_cnt; i++) {
+		if (parser_encode(unit, tokens, lex->lines[i]) < 0) {
+			lex->line = lex->lines[i];
+			ret = fail(lex, unit->err);
+		}
+
+		while (*tokens++);
+	}
+
+	if (lex->name == LEXER_NONE) unit->lead = unit->stream->cnt - off;
+
+	lex->str_cnt   = 0;
+	lex->off_cnt   = 0;
+	lex->lines_cnt = 0;
+
+	return ret;
+}
+
+static int push_eol(lexer_t *lex)
+{
+	if (lex->off_cnt + 1 > lex->off_siz) {
+		size_t *tmp = alloc_grow(
+			lex->off,
+			&lex->off_siz,
+			lex->off_cnt + 1,
+			sizeof(*lex->off)
+		);
+		if (!tmp) return -1;
+
+		lex->off = tmp;
+	}
+
+	if (lex->lines_cnt + 1 > lex->lines_siz) {
+		size_t *tmp = alloc_grow(
+			lex->lines,
+			&lex->lines_siz,
+			lex->lines_cnt + 1,
+			sizeof(*lex->lines)
+		);
+		if (!tmp) return -1;
+
+		lex->lines = tmp;
+	}
+
+	lex->off[lex->off_cnt++]     = LEXER_NONE;
+	lex->lines[lex->lines_cnt++] = lex->line;
+
+	return 0;
+}
+
+static int push_mark(size_t **marks, size_t *siz, size_t *cnt, size_t off)
+{
+	if (*cnt + 1 > *siz) {
+		size_t *tmp = alloc_grow(*marks, siz, *cnt + 1, sizeof(**marks));
+		if (!tmp) return -1;
+
+		*marks = tmp;
+	}
+
+	(*marks)[(*cnt)++] = off;
+
+	return 0;
+}
+
+static int push_token(lexer_t *lex, const char *tok, size_t len, enum token_kind kind)
+{
+	// leave room for whole-vector stores when folding
+	if (lex->str_cnt + len + LEXER_SLACK > lex->str_siz) {
+		char *tmp = alloc_grow(
+			lex->str,
+			&lex->str_siz,
+			lex->str_cnt + len + LEXER_SLACK,
+			sizeof(*lex->str)
+		);
+		if (!tmp) return -1;
+
+		lex->str = tmp;
+	}
+
+	if (kind == TOKEN_NAME) {
+		lex->name = lex->str_cnt;
+	} else {
+		if (lex->off_cnt + 1 > lex->off_siz) {
+			size_t *tmp = alloc_grow(
+				lex->off,
+				&lex->off_siz,
+				lex->off_cnt + 1,
+				sizeof(*lex->off)
+			);
+			if (!tmp) return -1;
+
+			lex->off = tmp;
+		}
+
+		lex->off[lex->off_cnt++] = lex->str_cnt;
+	}
+
+	// only mnemonics are folded, labels are case-sensitive
+	if (kind == TOKEN_MNEMONIC) fold(lex->str + lex->str_cnt, tok, len, lex->end);
+	else memcpy(lex->str + lex->str_cnt, tok, len);
+	lex->str_cnt += len;
+	lex->str[lex->str_cnt++] = '\0';
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * lexer.h -- source lexing
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_LEXER
+#define JAVK_AS_ASM_LEXER
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm/unit.h"
+
+
+#define LEXER_NONE ((size_t) -1)
+
+
+typedef struct lexer_s {
+	const struct lexer_impl_s *impl;  // see lexer_select()
+
+	unit_t     *unit;   // receives encoded sections
+	const char *end;    // end of the input
+	const char *blk;    // classified block
+	uint64_t    delim;  // delimiter bytes in blk
+	uint64_t    blank;  // blank bytes in blk
+
+	size_t   line;     // current line, or the failing one
+	size_t   secline;  // line of the current label
+	int      err;      // why lexing failed, one of enum javk_as_error
+
+	char    *str;      // token text
+	size_t   str_cnt;
+	size_t   str_siz;
+
+	size_t  *off;      // token offsets into str, LEXER_NONE ends a line
+	size_t   off_cnt;
+	size_t   off_siz;
+
+	const char **tokv;
+	size_t       tokv_siz;
+
+	size_t  *lines;    // line of each statement
+	size_t   lines_cnt;
+	size_t   lines_siz;
+
+	size_t name;       // offset of the label name, LEXER_NONE if continued
+} lexer_t;
+
+
+int         lex(lexer_t *lex, unit_t *unit, const char *buf, size_t len);
+int         lex_labels(const char *buf, size_t len, size_t **marks, size_t *siz, size_t *cnt);
+const char *lex_next_label(const char *pos, const char *end);
+lexer_t    *lexer_alloc(void);
+void        lexer_free(lexer_t *lex);
+// name the classifier lex uses, NULL for the fastest this machine runs;
+// returns its name or NULL if unsupported, a NULL lex only checks
+const char *lexer_select(lexer_t *lex, const char *name);
+
+
+#endif /* JAVK_AS_ASM_LEXER */
@@ -0,0 +1,74 @@
+/*
+ * lexer_private.h -- source lexing
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_LEXER_PRIVATE
+#define JAVK_AS_ASM_LEXER_PRIVATE
+
+
+#include "asm/lexer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define LEXER_X86
+#endif
+
+#define LEXER_BLKSIZ 64
+#define LEXER_SLACK  16
+
+
+enum token_kind {
+	TOKEN_NAME,      // label being defined
+	TOKEN_MNEMONIC,
+	TOKEN_OPERAND,
+};
+
+typedef struct lexer_impl_s {
+	const char *name;
+	void      (*classify)(const char *pos, size_t len, uint64_t *delim, uint64_t *blank);
+} lexer_impl_t;
+
+
+static void select_auto(void);
+
+static inline bool is_blank(char c);
+static inline bool is_delim(char c);
+
+static void classify_scalar(const char *pos, size_t len, uint64_t *delim, uint64_t *blank);
+#ifdef LEXER_X86
+static void classify_sse2(const char *pos, size_t len, uint64_t *delim, uint64_t *blank);
+static void classify_avx2(const char *pos, size_t len, uint64_t *delim, uint64_t *blank);
+#endif
+
+static inline void        load(lexer_t *lex, const char *pos);
+static inline const char *find_delim(lexer_t *lex, const char *pos);
+static const char        *find_eol(const char *pos, const char *end);
+static inline void        fold(char *dst, const char *src, size_t len, const char *end);
+static inline const char *skip_blank(lexer_t *lex, const char *pos);
+
+static int fail(lexer_t *lex, int err);
+static int lexer_flush(lexer_t *lex);
+static int push_eol(lexer_t *lex);
+static int push_mark(size_t **marks, size_t *siz, size_t *cnt, size_t off);
+static int push_token(lexer_t *lex, const char *tok, size_t len, enum token_kind kind);
+
+
+#endif /* JAVK_AS_ASM_LEXER_PRIVATE */
@@ -20,331 +20,548 @@
 #include "asm/parser.h"
 #include "asm/parser_private.h"
 
-#include <ctype.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "asm/phf.h"
+#include "asm/phf_tables.h"
 #include "asm/section.h"
-#include "dll.h"
-#include "ht.h"
-
-
-static dll_t *labels_dll;
-
-static ht_t *keywords_ht;
-static ht_t *labels_ht;
-static ht_t *registers_ht;
-
-static keyword_t keywords[] = {
-	/* opcodes */
-	{"ADD", 4, parser_add},  // add
-	{"SUB", 4, parser_sub},  // subtract
-	{"NEG", 4, parser_neg},  // negate
-	{"AND", 4, parser_and},  // and
-	{"ORR", 4, parser_orr},  // inclusive or
-	{"EOR", 4, parser_eor},  // exclusive or
-	{"LSL", 4, parser_lsl},  // logical shift left
-	{"LSR", 4, parser_lsr},  // logical shift right
-	{"MVA", 4, NULL},        // move 'a' register
-	{"MVB", 4, NULL},        // move 16-bit register
-	{"LNL", 4, NULL},        // load nibble low
-	{"LNH", 4, NULL},        // load nibble high
-	{"LDB", 4, NULL},        // load byte
-	{"STB", 4, NULL},        // store byte
-	{"JMP", 4, NULL},        // jump
-	{"JPL", 4, NULL},        // jump (with link)
-
-	/* mnemonics */
-	{"LDA", 4, parser_lda},  // load accumulator
-	{"NOP", 4, parser_nop},  // no operation
+#include "asm/unit.h"
+#include "alloc.h"
+#include "arena.h"
+#include "intern.h"
+#include "javk-as.h"
+#include "seq.h"
+
+
+static const keyword_t keywords[] = {
+#define KEYWORD(key, parser) {key, sizeof(key), parser},
+#include "asm/keywords.def"
+#undef KEYWORD
 };
 
-static register_t registers[] = {
-	{"A", 2, A},  // accumulator
-	{"B", 2, B},  // b register
-	{"C", 2, C},  // c register
-	{"D", 2, D},  // d register
-	{"E", 2, E},  // e register
-	{"F", 2, F},  // f register
-	{"G", 2, G},  // g register
-	{"H", 2, H},  // h register
-	{"I", 2, I},  // i register
-	{"J", 2, J},  // j register
-	{"K", 2, K},  // k register
-	{"L", 2, L},  // l register
-	{"M", 2, M},  // m register
-	{"N", 2, N},  // n register
-	{"O", 2, O},  // o register
-	{"Z", 2, Z},  // zero register
-
-	{"PC", 3, PC},  // program counter
-	{"SP", 3, SP},  // stack pointer
-	{"IJ", 3, IJ},  // intended jump
-	{"KL", 3, KL},  // kl register
+static const register_t registers[] = {
+#define REGISTER(key, val, wide) {key, sizeof(key), val, wide},
+#include "asm/registers.def"
+#undef REGISTER
 };
 
-static char tokenbuf[TOKENSIZ];
 
+parser_t *parser_alloc(void)
+{
+	parser_t *tmp = alloc_calloc(1, sizeof(parser_t));
+	if (!tmp) return NULL;
+
+	tmp->arena = arena_alloc();
+	if (!tmp->arena) goto error;
+
+	tmp->labels_seq = seq_alloc(tmp->arena);
+	if (!tmp->labels_seq) goto error;
 
-int parse_section(const char *name, const char ***keys)
+	tmp->names = intern_alloc();
+	if (!tmp->names) goto error;
+
+	tmp->units = seq_alloc(tmp->arena);
+	if (!tmp->units) goto error;
+
+	tmp->pending = seq_alloc(tmp->arena);
+	if (!tmp->pending) goto error;
+
+	return tmp;
+
+error:
+	parser_free(tmp);
+	return NULL;
+}
+
+size_t parser_copy(const parser_t *parser, uint8_t *buf, size_t siz)
 {
-	int ret;
+	size_t       cnt = 0;
+	seq_iter_t   it;
+	void       **data;
+
+	seq_iter(parser->units, &it);
+	while ((data = seq_next(&it)) && cnt < siz) {
+		const section_t *stream = ((const unit_t*) *data)->stream;
+
+		size_t len = (stream->cnt < siz - cnt) ? stream->cnt : siz - cnt;
+		memcpy(buf + cnt, stream->instr, len);
+		cnt += len;
+	}
 
-	if (!keys) return -1;
+	return cnt;
+}
 
-	label_t *label = label_alloc(name);
-	if (!label) return -1;
+int parser_emit(const parser_t *parser, int fd)
+{
+	const section_t  *secs[SECTION_IOVCNT];
+	size_t            cnt = 0;
+	seq_iter_t        it;
+	void            **data;
 
-	ret = dll_append(labels_dll, label);
-	if (ret < 0) goto dll_append_error;
+	// units were linked in source order, so their streams are the binary
+	seq_iter(parser->units, &it);
+	while ((data = seq_next(&it))) {
+		const unit_t *unit = *data;
 
-	ret = ht_set(labels_ht, label->key, label->len, label);
-	if (ret < 0) goto error;
+		if (!unit->stream->cnt) continue;
 
-	keyword_t  *keyword;
-	const char *key;
-	size_t      len;
-	while (*keys) {
-		key = **keys;
+		secs[cnt++] = unit->stream;
+		if (cnt < SECTION_IOVCNT) continue;
 
-		len = strlen(key) + 1;
-		if (len > TOKENSIZ) goto error;
+		if (section_writev(fd, secs, cnt) < 0) return -1;
+		cnt = 0;
+	}
 
-		int i = 0;
-		do {
-			tokenbuf[i] = toupper(key[i]);
-			++i;
-		} while (key[i - 1]);
-		key = tokenbuf;
+	return section_writev(fd, secs, cnt);
+}
 
-		keyword = ht_get(keywords_ht, key, len);
-		if (!keyword) goto error;
+int parser_encode(unit_t *unit, const char **tokens, size_t line)
+{
+	const keyword_t *keyword = keyword_get(tokens[0], strlen(tokens[0]) + 1);
+	if (!keyword || !keyword->parser)
+		return reject(unit, JAVK_AS_ERROR_MNEMONIC);
 
-		ret = keyword->parser(label->sec, *keys);
-		if (ret < 0) goto error;
+	size_t refs = unit->refs_cnt;
 
-		++keys;
+	unit->err = JAVK_AS_ERROR_NONE;
+	if (keyword->parser(unit, tokens) < 0) {
+		// anything not rejected outright failed to allocate
+		if (!unit->err) unit->err = JAVK_AS_ERROR_NOMEM;
+		return -1;
 	}
 
+	// references made by the statement are reported at its line
+	while (refs < unit->refs_cnt) unit->refs[refs++].line = line;
+
 	return 0;
+}
 
-dll_append_error:
-	// NOTE: if label was successfully added to labels_dll,
-	// we risk a double free condition, parser_rm() will
-	// cleanup after us if we fail after dll_append()
-	label_free(label);
+void parser_free(parser_t *parser)
+{
+	if (!parser) return;
 
-error:
-	return -1;
+	// labels and sequence chunks all live in the arena, units are borrowed
+	seq_free(parser->labels_seq, NULL);
+	alloc_free(parser->labels);
+	intern_free(parser->names);
+	seq_free(parser->units, NULL);
+	seq_free(parser->pending, NULL);
+
+	arena_free(parser->arena);
+	alloc_free(parser);
+}
+
+bool parser_is_register(const char *name, size_t len)
+{
+	return register_get(name, len + 1);
 }
 
-int parser_init(void)
+int parser_link(parser_t *parser, unit_t *unit, size_t *line)
 {
-	labels_dll = dll_alloc();
-	if (!labels_dll) return -1;
+	*line = 0;
 
-	keywords_ht = ht_alloc();
-	if (!keywords_ht) goto error;
-	labels_ht = ht_alloc();
-	if (!labels_ht) goto error;
-	registers_ht = ht_alloc();
-	if (!registers_ht) goto error;
+	// leading instructions extend the last section linked so far
+	if (unit->lead) {
+		*line = unit->line;
+		if (!parser->last) return fail(parser, JAVK_AS_ERROR_LEAD);
 
-	for (size_t i = 0; i < sizeof(keywords) / sizeof(keyword_t); i++) {
-		if (0 > ht_set(
-				keywords_ht,
-				keywords[i].key,
-				keywords[i].len,
-				keywords + i
-			)
-		)
-			goto error;
+		parser->last->cnt += unit->lead;
 	}
 
-	for (size_t i = 0; i < sizeof(registers) / sizeof(register_t); i++) {
-		if (0 > ht_set(
-				registers_ht,
-				registers[i].key,
-				registers[i].len,
-				registers + i
-			)
-		)
-			goto error;
+	// definitions and references are taken in source order, so a reference
+	// only waits on a fixup list when its label really comes later
+	size_t d = 0;
+	size_t r = 0;
+	while (d < unit->defs_cnt || r < unit->refs_cnt) {
+		if (d < unit->defs_cnt
+			&& (r == unit->refs_cnt || unit->defs[d].off <= unit->refs[r].off)
+		) {
+			size_t end = (d + 1 < unit->defs_cnt)
+				? unit->defs[d + 1].off
+				: unit->stream->cnt;
+
+			*line = unit->defs[d].line;
+			if (label_define(parser, unit, unit->defs + d, end) < 0) return -1;
+
+			++d;
+		} else {
+			*line = unit->refs[r].line;
+			if (label_refer(parser, unit, unit->refs + r) < 0) return -1;
+
+			++r;
+		}
 	}
 
+	*line = 0;
+	if (!seq_append(parser->units, unit)) return fail(parser, JAVK_AS_ERROR_NOMEM);
+	parser->size     += unit->stream->cnt;
+	parser->sections += unit->defs_cnt;
+
 	return 0;
+}
 
-error:
-	dll_free(labels_dll, NULL);
+int parser_finish(const parser_t *parser, const unit_t **unit, size_t *line)
+{
+	const fixup_t  *first = NULL;
+	seq_iter_t      it;
+	void          **data;
+
+	// report the earliest reference that never found its label
+	seq_iter(parser->pending, &it);
+	while ((data = seq_next(&it))) {
+		const label_t *label = *data;
+
+		if (label->defined) continue;
+
+		for (const fixup_t *fix = label->fixups; fix; fix = fix->next)
+			if (!first || fix->pos < first->pos) first = fix;
+	}
 
-	ht_free(keywords_ht,  NULL);
-	ht_free(labels_ht,    NULL);
-	ht_free(registers_ht, NULL);
+	if (!first) return 0;
+
+	*unit = first->unit;
+	*line = first->line;
 
 	return -1;
 }
 
-void parser_rm(void)
+void parser_reset(parser_t *parser)
 {
-	dll_free(labels_dll, label_free);
+	// tables keep their capacity, labels go with the arena
+	seq_clear(parser->labels_seq, NULL);
+	intern_clear(parser->names);
+	seq_clear(parser->units, NULL);
+	seq_clear(parser->pending, NULL);
+
+	arena_reset(parser->arena);
+
+	parser->labels_cnt = 0;
+	parser->size       = 0;
+	parser->sections   = 0;
+	parser->last       = NULL;
+	parser->err        = JAVK_AS_ERROR_NONE;
+}
 
-	ht_free(keywords_ht,  NULL);
-	ht_free(labels_ht,    NULL);
-	ht_free(registers_ht, NULL);
+
+static const keyword_t *keyword_get(const char *key, size_t len)
+{
+	uint32_t word;
+	if (!phf_pack(key, len, &word)) return NULL;
+
+	const phf_slot_t *slot = keywords_phf + phf_hash(
+		word,
+		KEYWORDS_PHF_SEED,
+		KEYWORDS_PHF_BITS
+	);
+	if (slot->word != word) return NULL;
+
+	return keywords + slot->idx;
 }
 
+static const register_t *register_get(const char *key, size_t len)
+{
+	uint32_t word;
+	if (!phf_pack(key, len, &word)) return NULL;
 
-static label_t *label_alloc(const char *key)
+	// operands keep their case so labels can be matched exactly
+	word = phf_upper(word);
+
+	const phf_slot_t *slot = registers_phf + phf_hash(
+		word,
+		REGISTERS_PHF_SEED,
+		REGISTERS_PHF_BITS
+	);
+	if (slot->word != word) return NULL;
+
+	return registers + slot->idx;
+}
+
+static const register_t *narrow_get(unit_t *unit, const char **tokens)
 {
-	label_t *tmp = calloc(1, sizeof(label_t));
-	if (!tmp) return NULL;
+	if (!tokens[1] || tokens[2]) {
+		reject(unit, JAVK_AS_ERROR_OPERANDS);
+		return NULL;
+	}
 
-	tmp->len = strlen(key) + 1;
+	const register_t *reg = register_get(tokens[1], strlen(tokens[1]) + 1);
 
-	tmp->key = malloc(tmp->len);
-	if (!tmp->key) goto error;
-	strncpy(tmp->key, key, tmp->len);
+	// only 8-bit registers can be used
+	if (!reg || reg->wide) {
+		reject(unit, JAVK_AS_ERROR_REGISTER);
+		return NULL;
+	}
 
-	tmp->sec = section_alloc(SECSIZ);
-	if (!tmp->sec) goto error;
+	return reg;
+}
 
-	return tmp;
+static int reject(unit_t *unit, int err)
+{
+	unit->err = err;
+	return -1;
+}
 
-error:
-	label_free(tmp);
-	return NULL;
+
+static int fail(parser_t *parser, int err)
+{
+	parser->err = err;
+	return -1;
 }
 
-static void label_free(void *label)
+static label_t *label_alloc(parser_t *parser, uint32_t id)
 {
-	label_t *tmp = label;
+	if (parser->labels_cnt + 1 > parser->labels_siz) {
+		label_t **tmp = alloc_grow(
+			parser->labels,
+			&parser->labels_siz,
+			parser->labels_cnt + 1,
+			sizeof(*parser->labels)
+		);
+		if (!tmp) return NULL;
+
+		parser->labels = tmp;
+	}
+
+	label_t *tmp = arena_malloc(parser->arena, sizeof(label_t));
+	if (!tmp) return NULL;
 
-	if (!tmp) return;
+	tmp->id      = id;
+	tmp->defined = false;
+	tmp->off     = 0;
+	tmp->cnt     = 0;
+	tmp->fixups  = NULL;
 
-	if (tmp->key) free(tmp->key);
-	if (tmp->sec) section_free(tmp->sec);
+	parser->labels[parser->labels_cnt++] = tmp;
 
-	free(label);
+	return tmp;
 }
 
+static int label_define(parser_t *parser, const unit_t *unit, const unit_def_t *def, size_t end)
+{
+	label_t *label = label_get(parser, unit->names + def->name, NULL);
+	if (!label) return fail(parser, JAVK_AS_ERROR_NOMEM);
+	if (label->defined) return fail(parser, JAVK_AS_ERROR_REDEFINED);
+
+	label->defined = true;
+	label->off     = parser->size + def->off;
+	label->cnt     = end - def->off;
+
+	// jumps only reach a 16-bit address
+	if (label->fixups && label->off > UINT16_MAX)
+		return fail(parser, JAVK_AS_ERROR_ADDRESS);
+
+	for (fixup_t *fix = label->fixups; fix; fix = fix->next)
+		patch(fix->at, label->off);
+	label->fixups = NULL;
 
-static int parser_add(section_t *sec, const char **tokens)
+	if (!seq_append(parser->labels_seq, label))
+		return fail(parser, JAVK_AS_ERROR_NOMEM);
+	parser->last = label;
+
+	return 0;
+}
+
+static label_t *label_get(parser_t *parser, const char *name, bool *created)
 {
-	return parser_arithmetic(sec, tokens, ADD);
+	uint32_t id = intern_get(parser->names, name, strlen(name));
+	if (id == INTERN_NONE) return NULL;
+
+	// a name interned for the first time takes the next id
+	bool fresh = id == parser->labels_cnt;
+	if (created) *created = fresh;
+
+	return (fresh) ? label_alloc(parser, id) : parser->labels[id];
+}
+
+static int label_refer(parser_t *parser, unit_t *unit, const unit_ref_t *ref)
+{
+	instruction_t *at = unit->stream->instr + ref->off;
+
+	bool     created;
+	label_t *label = label_get(parser, unit->names + ref->name, &created);
+	if (!label) return fail(parser, JAVK_AS_ERROR_NOMEM);
+
+	if (created && !seq_append(parser->pending, label))
+		return fail(parser, JAVK_AS_ERROR_NOMEM);
+
+	if (label->defined) {
+		if (label->off > UINT16_MAX) return fail(parser, JAVK_AS_ERROR_ADDRESS);
+
+		patch(at, label->off);
+		return 0;
+	}
+
+	fixup_t *fix = arena_malloc(parser->arena, sizeof(fixup_t));
+	if (!fix) return fail(parser, JAVK_AS_ERROR_NOMEM);
+
+	fix->next = label->fixups;
+	fix->at   = at;
+	fix->unit = unit;
+	fix->line = ref->line;
+	fix->pos  = parser->size + ref->off;
+
+	label->fixups = fix;
+
+	return 0;
 }
 
-static int parser_sub(section_t *sec, const char **tokens)
+static void patch(instruction_t *at, size_t addr)
 {
-	return parser_arithmetic(sec, tokens, SUB);
+	// I takes the high byte and J the low byte, a nibble at a time
+	at[0] = INSTR(LNL, (addr >> 8) & 0xf);
+	at[1] = INSTR(LNH, (addr >> 12) & 0xf);
+	at[3] = INSTR(LNL, addr & 0xf);
+	at[4] = INSTR(LNH, (addr >> 4) & 0xf);
 }
 
-static int parser_neg(section_t *sec, const char **tokens)
+
+static int parser_add(unit_t *unit, const char **tokens)
 {
-	return parser_arithmetic(sec, tokens, NEG);
+	return parser_arithmetic(unit, tokens, ADD);
 }
 
-static int parser_and(section_t *sec, const char **tokens)
+static int parser_sub(unit_t *unit, const char **tokens)
 {
-	return parser_arithmetic(sec, tokens, AND);
+	return parser_arithmetic(unit, tokens, SUB);
 }
 
-static int parser_orr(section_t *sec, const char **tokens)
+static int parser_neg(unit_t *unit, const char **tokens)
 {
-	return parser_arithmetic(sec, tokens, ORR);
+	return parser_arithmetic(unit, tokens, NEG);
 }
 
-static int parser_eor(section_t *sec, const char **tokens)
+static int parser_and(unit_t *unit, const char **tokens)
 {
-	return parser_arithmetic(sec, tokens, EOR);
+	return parser_arithmetic(unit, tokens, AND);
 }
 
-static int parser_lsl(section_t *sec, const char **tokens)
+static int parser_orr(unit_t *unit, const char **tokens)
 {
-	return parser_shift(sec, tokens, LSL);
+	return parser_arithmetic(unit, tokens, ORR);
 }
 
-static int parser_lsr(section_t *sec, const char **tokens)
+static int parser_eor(unit_t *unit, const char **tokens)
 {
-	return parser_shift(sec, tokens, LSR);
+	return parser_arithmetic(unit, tokens, EOR);
 }
 
+static int parser_lsl(unit_t *unit, const char **tokens)
+{
+	return parser_shift(unit, tokens, LSL);
+}
 
-static int parser_arithmetic(section_t *sec, const char **tokens, unsigned opcode)
+static int parser_lsr(unit_t *unit, const char **tokens)
 {
-	const char *tmp = tokens[1];
-	size_t      i   = 0;
+	return parser_shift(unit, tokens, LSR);
+}
 
-	do {
-		tokenbuf[i] = toupper(tmp[i]);
-		++i;
-	} while (tmp[i - 1]);
 
-	register_t *reg = ht_get(registers_ht, tokenbuf, i);
+static int parser_arithmetic(unit_t *unit, const char **tokens, unsigned opcode)
+{
+	const register_t *reg = narrow_get(unit, tokens);
 	if (!reg) return -1;
 
-	// only 8-bit registers can be used
-	register_t *bad = registers + (sizeof(registers) / sizeof(register_t));
-	if (reg == bad - 1) return -1;
-	if (reg == bad - 2) return -1;
+	instruction_t instr = INSTR(opcode, reg->val);
 
-	if (sec->cnt + 1 > sec->siz)
-		if (section_realloc(sec, sec->siz * 2) < 0)
-			return -1;
+	return section_emit(unit->stream, &instr, 1);
+}
+
+static int parser_shift(unit_t *unit, const char **tokens, unsigned opcode)
+{
+	if (!tokens[1] || tokens[2]) return reject(unit, JAVK_AS_ERROR_OPERANDS);
 
-	sec->instr[sec->cnt].opcode  = opcode;
-	sec->instr[sec->cnt].operand = reg->val;
+	char          *end;
+	unsigned long  shamt = strtoul(tokens[1], &end, 0);
+	if (*end) return reject(unit, JAVK_AS_ERROR_NUMBER);
+	if (shamt > 0xf) return reject(unit, JAVK_AS_ERROR_RANGE);
 
-	++sec->cnt;
+	instruction_t instr = INSTR(opcode, shamt);
 
-	return 0;
+	return section_emit(unit->stream, &instr, 1);
 }
 
-static int parser_shift(section_t *sec, const char **tokens, unsigned opcode)
+
+static int parser_jump(unit_t *unit, const char **tokens, unsigned opcode)
 {
-	unsigned long shamt = strtoul(tokens[1], NULL, 0);
+	if (!tokens[1] || tokens[2]) return reject(unit, JAVK_AS_ERROR_OPERANDS);
 
-	if (sec->cnt + 1 > sec->siz)
-		if (section_realloc(sec, sec->siz * 2) < 0)
-			return -1;
+	const register_t *reg = register_get(tokens[1], strlen(tokens[1]) + 1);
+	if (reg) {
+		// only 16-bit registers hold an address
+		if (!reg->wide) return reject(unit, JAVK_AS_ERROR_REGISTER);
 
-	sec->instr[sec->cnt].opcode  = opcode;
-	sec->instr[sec->cnt].operand = shamt;
+		instruction_t instr = INSTR(opcode, reg->val);
 
-	++sec->cnt;
+		return section_emit(unit->stream, &instr, 1);
+	}
 
-	return 0;
+	// the address is patched in once the label is linked
+	const instruction_t instr[JUMP_LEN] = {
+		INSTR(LNL, 0),
+		INSTR(LNH, 0),
+		INSTR(MVA, I),
+		INSTR(LNL, 0),
+		INSTR(LNH, 0),
+		INSTR(MVA, J),
+		INSTR(opcode, IJ),
+	};
+
+	// parser_encode() fills in the line
+	if (unit_refer(unit, tokens[1], unit->stream->cnt, 0) < 0) return -1;
+
+	return section_emit(unit->stream, instr, JUMP_LEN);
 }
 
 
-static int parser_lda(section_t *sec, const char **tokens)
+static int parser_jmp(unit_t *unit, const char **tokens)
 {
-	int         ret;
-	const char *zr_clr_tokens[2];
+	return parser_jump(unit, tokens, JMP);
+}
+
+static int parser_jpl(unit_t *unit, const char **tokens)
+{
+	return parser_jump(unit, tokens, JPL);
+}
+
+static int parser_lda(unit_t *unit, const char **tokens)
+{
+	// check the operand before anything reaches the section
+	const register_t *reg = narrow_get(unit, tokens);
+	if (!reg) return -1;
 
 	// clear the accumulator first
-	zr_clr_tokens[0] = tokens[0];
-	zr_clr_tokens[0] = "Z";
-	ret = parser_and(sec, zr_clr_tokens);
-	if (ret < 0) return -1;
+	instruction_t instr[2] = { INSTR(AND, Z), INSTR(ORR, reg->val) };
 
-	ret = parser_orr(sec, tokens);
-	if (ret < 0) goto error;
+	return section_emit(unit->stream, instr, 2);
+}
 
-	return 0;
+static int parser_ldi(unit_t *unit, const char **tokens)
+{
+	if (!tokens[1] || tokens[2]) return reject(unit, JAVK_AS_ERROR_OPERANDS);
 
-error:
-	--sec->cnt;
-	return -1;
+	char          *end;
+	unsigned long  val = strtoul(tokens[1], &end, 0);
+	if (*end) return reject(unit, JAVK_AS_ERROR_NUMBER);
+	if (val > 0xff) return reject(unit, JAVK_AS_ERROR_RANGE);
+
+	// the expansion depends on what the section already left in a
+	return section_load(unit->stream, val);
 }
 
-static int parser_nop(section_t *sec, const char **tokens)
+static int parser_nop(unit_t *unit, const char **tokens)
 {
-	const char *zr_orr_tokens[2];
+	const char *zr_orr_tokens[3];
+
+	if (tokens[1]) return reject(unit, JAVK_AS_ERROR_OPERANDS);
 
 	zr_orr_tokens[0] = tokens[0];
 	zr_orr_tokens[1] = "Z";
+	zr_orr_tokens[2] = NULL;
 
 	// do nothing by preserving the accumulator
-	return parser_orr(sec, zr_orr_tokens);
+	return parser_orr(unit, zr_orr_tokens);
 }
@@ -20,9 +20,53 @@
 #define JAVK_AS_ASM_PARSER
 
 
-int  parse_section(const char *name, const char ***keys);
-int  parser_init(void);
-void parser_rm(void);
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm/section.h"
+#include "asm/unit.h"
+#include "arena.h"
+#include "intern.h"
+#include "seq.h"
+
+
+// a jump to a label loads its address into IJ first
+#define JUMP_LEN 7
+
+#define PARSER_REVISION 2  // bump whenever any source encodes differently
+
+
+typedef struct parser_s {
+	arena_t         *arena;
+	seq_t           *labels_seq;
+	struct label_s **labels;   // by interned name, whose ids are dense
+	size_t           labels_cnt;
+	size_t           labels_siz;
+	intern_t        *names;
+	seq_t           *units;    // linked units, in source order, borrowed
+	seq_t           *pending;  // labels first seen as a forward reference
+	size_t           size;     // bytes across all units
+	size_t           sections; // labels defined across all units
+	struct label_s  *last;     // label of the last section linked
+	int              err;      // why linking failed, one of enum javk_as_error
+} parser_t;
+
+
+parser_t *parser_alloc(void);
+size_t    parser_copy(const parser_t *parser, uint8_t *buf, size_t siz);
+int       parser_emit(const parser_t *parser, int fd);
+// encodes the statement on line, its mnemonic expected in upper case;
+// unit->err says why it failed
+int       parser_encode(unit_t *unit, const char **tokens, size_t line);
+// fails if a reference never found its label, *line is where it was made
+int       parser_finish(const parser_t *parser, const unit_t **unit, size_t *line);
+void      parser_free(parser_t *parser);
+// whether the len bytes at name read as a register, which no label may
+bool      parser_is_register(const char *name, size_t len);
+// *line locates the failing definition or reference within unit
+int       parser_link(parser_t *parser, unit_t *unit, size_t *line);
+void      parser_reset(parser_t *parser);
 
 
 #endif /* JAVK_AS_ASM_PARSER */
@@ -22,51 +22,75 @@
 
 #include "asm/parser.h"
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "asm/section.h"
-
-
-#define SECSIZ   64
-#define TOKENSIZ 4
+#include "asm/unit.h"
 
 
 typedef struct keyword_s {
-	char  *key;
-	size_t len;
-	int   (*parser)(section_t *sec, const char **tokens);
+	const char *key;
+	size_t      len;
+	int       (*parser)(unit_t *unit, const char **tokens);
 } keyword_t;
 
 typedef struct register_s {
-	char     *key;
-	size_t    len;
-	unsigned  val;
+	const char *key;
+	size_t      len;
+	unsigned    val;
+	bool        wide;
 } register_t;
 
+typedef struct fixup_s {
+	struct fixup_s *next;
+	instruction_t  *at;    // expansion awaiting the address
+	const unit_t   *unit;  // where the reference was made
+	size_t          line;
+	size_t          pos;   // offset of the expansion in the binary
+} fixup_t;
+
 typedef struct label_s {
-	char      *key;
-	size_t     len;
-	section_t *sec;
+	uint32_t  id;       // interned name
+	bool      defined;
+	size_t    off;      // range of the section within the stream
+	size_t    cnt;
+	fixup_t  *fixups;   // forward references, until defined
 } label_t;
 
 
-static label_t *label_alloc(const char *key);
-static void     label_free(void *label);
-
-static int parser_add(section_t *sec, const char **tokens);
-static int parser_sub(section_t *sec, const char **tokens);
-static int parser_neg(section_t *sec, const char **tokens);
-static int parser_and(section_t *sec, const char **tokens);
-static int parser_orr(section_t *sec, const char **tokens);
-static int parser_eor(section_t *sec, const char **tokens);
-static int parser_lsl(section_t *sec, const char **tokens);
-static int parser_lsr(section_t *sec, const char **tokens);
-
-static int parser_arithmetic(section_t *sec, const char **tokens, unsigned opcode);
-static int parser_shift(section_t *sec, const char **tokens, unsigned opcode);
-
-static int parser_lda(section_t *sec, const char **tokens);
-static int parser_nop(section_t *sec, const char **tokens);
+static const keyword_t  *keyword_get(const char *key, size_t len);
+static const register_t *narrow_get(unit_t *unit, const char **tokens);
+static const register_t *register_get(const char *key, size_t len);
+static int               reject(unit_t *unit, int err);
+
+static int      fail(parser_t *parser, int err);
+static label_t *label_alloc(parser_t *parser, uint32_t id);
+static int      label_define(parser_t *parser, const unit_t *unit, const unit_def_t *def, size_t end);
+static label_t *label_get(parser_t *parser, const char *name, bool *created);
+static int      label_refer(parser_t *parser, unit_t *unit, const unit_ref_t *ref);
+static void     patch(instruction_t *at, size_t addr);
+
+static int parser_add(unit_t *unit, const char **tokens);
+static int parser_sub(unit_t *unit, const char **tokens);
+static int parser_neg(unit_t *unit, const char **tokens);
+static int parser_and(unit_t *unit, const char **tokens);
+static int parser_orr(unit_t *unit, const char **tokens);
+static int parser_eor(unit_t *unit, const char **tokens);
+static int parser_lsl(unit_t *unit, const char **tokens);
+static int parser_lsr(unit_t *unit, const char **tokens);
+
+static int parser_arithmetic(unit_t *unit, const char **tokens, unsigned opcode);
+static int parser_shift(unit_t *unit, const char **tokens, unsigned opcode);
+
+static int parser_jump(unit_t *unit, const char **tokens, unsigned opcode);
+
+static int parser_jmp(unit_t *unit, const char **tokens);
+static int parser_jpl(unit_t *unit, const char **tokens);
+static int parser_lda(unit_t *unit, const char **tokens);
+static int parser_ldi(unit_t *unit, const char **tokens);
+static int parser_nop(unit_t *unit, const char **tokens);
 
 
 #endif /* JAVK_AS_ASM_PARSER_PRIVATE */
@@ -0,0 +1,206 @@
+/*
+ * peephole.c -- peephole optimizer
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "asm/peephole.h"
+#include "asm/peephole_private.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "asm/parser.h"
+#include "asm/section.h"
+#include "asm/superopt.h"
+#include "asm/superopt_table.h"
+#include "asm/unit.h"
+
+
+size_t peephole(unit_t *unit)
+{
+	instruction_t *instr = unit->stream->instr;
+	size_t         cnt   = unit->stream->cnt;
+	size_t         def   = 0;
+	size_t         ref   = 0;
+	size_t         floor = 0;
+	size_t         w     = 0;
+
+	for (size_t r = 0; r < cnt; r++) {
+		// nothing may move across a label, control can enter there
+		for (; def < unit->defs_cnt && unit->defs[def].off == r; def++) {
+			unit->defs[def].off = w;
+			floor = w;
+		}
+
+		// references are patched at link time and kept verbatim
+		if (ref < unit->refs_cnt && unit->refs[ref].off == r) {
+			unit->refs[ref++].off = w;
+
+			for (size_t i = 0; i < JUMP_LEN; i++) instr[w++] = instr[r + i];
+			r += JUMP_LEN - 1;
+
+			floor = w;
+			continue;
+		}
+
+		instr[w++] = instr[r];
+
+		// a linked jump returns right after itself
+		unsigned op = INSTR_OPCODE(instr[w - 1]);
+		if (op == JMP || op == JPL) {
+			floor = w;
+			continue;
+		}
+
+		w = reduce(instr, w, floor);
+	}
+
+	for (; def < unit->defs_cnt; def++) unit->defs[def].off = w;
+
+	if (unit->cont) unit->lead = (unit->defs_cnt) ? unit->defs[0].off : w;
+
+	unit->stream->cnt = w;
+
+	return cnt - w;
+}
+
+
+uint64_t peephole_revision(void)
+{
+	return SUPEROPT_TABLE_HASH ^ PEEPHOLE_REVISION;
+}
+
+static inline bool is_clear(instruction_t instr)
+{
+	return instr == INSTR(AND, Z)
+		|| instr == INSTR(EOR, A)
+		|| instr == INSTR(SUB, A);
+}
+
+static inline bool is_dead(instruction_t instr)
+{
+	// ORR Z is how a NOP is spelt, it stays wherever it was put
+	if (instr == INSTR(ORR, Z)) return false;
+
+	switch (INSTR_OPCODE(instr)) {
+		case ADD:
+		case SUB:
+		case NEG:
+		case AND:
+		case ORR:
+		case EOR:
+		case LSL:
+		case LSR:
+		case LNL:
+		case LNH:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+static int compare(const void *key, const void *ent)
+{
+	const superopt_t *x = key;
+	const superopt_t *y = ent;
+
+	if (x->len != y->len) return (x->len < y->len) ? -1 : 1;
+	if (x->key != y->key) return (x->key < y->key) ? -1 : 1;
+
+	return 0;
+}
+
+static size_t reduce(instruction_t *instr, size_t cnt, size_t floor)
+{
+	// every rewrite shrinks the tail, which may enable another one
+	while (cnt > floor) {
+		if (cnt - floor >= 2 && rewrite_pair(instr, &cnt)) continue;
+		if (rewrite_table(instr, &cnt, floor)) continue;
+
+		break;
+	}
+
+	return cnt;
+}
+
+static bool rewrite_pair(instruction_t *instr, size_t *cnt)
+{
+	instruction_t a  = instr[*cnt - 2];
+	instruction_t b  = instr[*cnt - 1];
+	unsigned      op = INSTR_OPCODE(a);
+
+	// a result nothing reads: ADD B; AND Z -> AND Z
+	if (b == INSTR(AND, Z) && is_dead(a)) {
+		instr[*cnt - 2] = b;
+		--*cnt;
+		return true;
+	}
+
+	// the accumulator is already clear: AND Z; EOR A -> AND Z
+	if (is_clear(a) && is_clear(b)) {
+		--*cnt;
+		return true;
+	}
+
+	// NEG A; NEG A -> nothing
+	if (a == INSTR(NEG, A) && b == INSTR(NEG, A)) {
+		*cnt -= 2;
+		return true;
+	}
+
+	// LSL 2; LSL 3 -> LSL 5
+	if ((op == LSL || op == LSR) && INSTR_OPCODE(b) == op) {
+		unsigned shamt = INSTR_OPERAND(a) + INSTR_OPERAND(b);
+
+		if (shamt <= PEEPHOLE_SHIFTMAX) {
+			instr[*cnt - 2] = INSTR(op, shamt);
+			--*cnt;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool rewrite_table(instruction_t *instr, size_t *cnt, size_t floor)
+{
+	// shorter windows first, the table assumes they were already tried
+	for (size_t len = 1; len <= SUPEROPT_TABLE_LEN && len <= *cnt - floor; len++) {
+		instruction_t *win = instr + *cnt - len;
+		if (!superopt_member(superopt_alphabet, *win)) break;
+
+		superopt_t key = {.key = superopt_pack(win, len), .len = len};
+
+		const superopt_t *ent = bsearch(
+			&key,
+			superopt_table,
+			SUPEROPT_TABLE_CNT,
+			sizeof(*superopt_table),
+			compare
+		);
+		if (!ent) continue;
+
+		superopt_unpack(ent->rep, ent->rlen, win);
+		*cnt -= len - ent->rlen;
+
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,38 @@
+/*
+ * peephole.h -- peephole optimizer
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_PEEPHOLE
+#define JAVK_AS_ASM_PEEPHOLE
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm/unit.h"
+
+
+#define PEEPHOLE_REVISION 1  // bump whenever a hand-written rewrite changes
+
+
+// rewrites the stream of unit in place, returns the instructions saved
+size_t   peephole(unit_t *unit);
+// changes with PEEPHOLE_REVISION and with the generated superopt table
+uint64_t peephole_revision(void);
+
+
+#endif /* JAVK_AS_ASM_PEEPHOLE */
@@ -0,0 +1,42 @@
+/*
+ * peephole_private.h -- peephole optimizer
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_PEEPHOLE_PRIVATE
+#define JAVK_AS_ASM_PEEPHOLE_PRIVATE
+
+
+#include "asm/peephole.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "asm/section.h"
+
+
+#define PEEPHOLE_SHIFTMAX 7  // widest shift with a well defined result
+
+
+static inline bool is_clear(instruction_t instr);
+static inline bool is_dead(instruction_t instr);
+static int         compare(const void *key, const void *ent);
+static size_t      reduce(instruction_t *instr, size_t cnt, size_t floor);
+static bool        rewrite_pair(instruction_t *instr, size_t *cnt);
+static bool        rewrite_table(instruction_t *instr, size_t *cnt, size_t floor);
+
+
+#endif /* JAVK_AS_ASM_PEEPHOLE_PRIVATE */
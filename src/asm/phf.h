@@ -0,0 +1,71 @@
+/*
+ * phf.h -- perfect hashing
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_PHF
+#define JAVK_AS_ASM_PHF
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define PHF_MAXLEN 4
+
+
+typedef struct phf_slot_s {
+	uint32_t word;
+	uint8_t  idx;
+} phf_slot_t;
+
+
+// keys are packed little-endian so the tables don't depend on the build host
+static inline bool phf_pack(const char *key, size_t len, uint32_t *word)
+{
+	// len includes the terminating NUL
+	if (len < 2 || len > PHF_MAXLEN + 1) return false;
+
+	uint32_t tmp = 0;
+	for (size_t i = 0; i < len - 1; i++)
+		tmp |= (uint32_t) (unsigned char) key[i] << (i * 8);
+
+	*word = tmp;
+
+	return true;
+}
+
+static inline uint32_t phf_upper(uint32_t word)
+{
+	uint32_t tmp = 0;
+
+	for (unsigned i = 0; i < 32; i += 8) {
+		uint32_t c = (word >> i) & 0xff;
+		if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+		tmp |= c << i;
+	}
+
+	return tmp;
+}
+
+static inline uint32_t phf_hash(uint32_t word, uint32_t seed, unsigned bits)
+{
+	return (word * seed) >> (32 - bits);
+}
+
+
+#endif /* JAVK_AS_ASM_PHF */
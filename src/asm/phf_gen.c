@@ -0,0 +1,154 @@
+/*
+ * phf_gen.c -- perfect hash table generator
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm/phf.h"
+
+
+#define PHF_MAXBITS  8
+#define PHF_MAXTRIES (1UL << 20)
+
+
+static const char *keywords[] = {
+#define KEYWORD(key, parser) key,
+#include "asm/keywords.def"
+#undef KEYWORD
+};
+
+static const char *registers[] = {
+#define REGISTER(key, val, wide) key,
+#include "asm/registers.def"
+#undef REGISTER
+};
+
+
+static bool try_seed(const uint32_t *words, size_t cnt, uint32_t seed, unsigned bits)
+{
+	uint8_t used[1 << PHF_MAXBITS] = {0};
+
+	for (size_t i = 0; i < cnt; i++) {
+		uint32_t h = phf_hash(words[i], seed, bits);
+		if (used[h]) return false;
+		used[h] = 1;
+	}
+
+	return true;
+}
+
+static int emit(FILE *stream, const char *macro, const char *name, const char **keys, size_t cnt)
+{
+	uint32_t words[1 << PHF_MAXBITS];
+
+	if (cnt > 1 << PHF_MAXBITS) return -1;
+
+	for (size_t i = 0; i < cnt; i++)
+		if (!phf_pack(keys[i], strlen(keys[i]) + 1, words + i)) return -1;
+
+	// xorshift32, fixed so the output is reproducible
+	uint32_t state = 0x9e3779b9;
+
+	for (unsigned bits = 1; bits <= PHF_MAXBITS; bits++) {
+		if ((1UL << bits) < cnt) continue;
+
+		for (unsigned long try = 0; try < PHF_MAXTRIES; try++) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			uint32_t seed = state | 1;
+			if (!try_seed(words, cnt, seed, bits)) continue;
+
+			fprintf(stream, "#define %s_PHF_SEED 0x%08xu\n", macro, seed);
+			fprintf(stream, "#define %s_PHF_BITS %u\n\n", macro, bits);
+
+			phf_slot_t slots[1 << PHF_MAXBITS] = {0};
+			for (size_t i = 0; i < cnt; i++) {
+				phf_slot_t *slot = slots + phf_hash(words[i], seed, bits);
+
+				slot->word = words[i];
+				slot->idx  = i;
+			}
+
+			fprintf(stream, "static const phf_slot_t %s_phf[] = {\n", name);
+			for (size_t i = 0; i < 1UL << bits; i++)
+				fprintf(stream, "\t{0x%08xu, %u},\n", slots[i].word, slots[i].idx);
+			fputs("};\n\n", stream);
+
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		fputs("usage: phf-gen output\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	FILE *stream = fopen(argv[1], "w");
+	if (!stream) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	fputs(
+		"/* generated by phf-gen, do not edit */\n"
+		"\n"
+		"#ifndef JAVK_AS_ASM_PHF_TABLES\n"
+		"#define JAVK_AS_ASM_PHF_TABLES\n"
+		"\n"
+		"\n"
+		"#include \"asm/phf.h\"\n"
+		"\n"
+		"\n",
+		stream
+	);
+
+	size_t keywords_cnt  = sizeof(keywords) / sizeof(*keywords);
+	size_t registers_cnt = sizeof(registers) / sizeof(*registers);
+
+	if (emit(stream, "KEYWORDS", "keywords", keywords, keywords_cnt) < 0)
+		goto error;
+	if (emit(stream, "REGISTERS", "registers", registers, registers_cnt) < 0)
+		goto error;
+
+	fputs("\n#endif /* JAVK_AS_ASM_PHF_TABLES */\n", stream);
+
+	if (fclose(stream)) {
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+error:
+	fputs("phf-gen: no perfect hash found\n", stderr);
+	fclose(stream);
+	remove(argv[1]);
+
+	return EXIT_FAILURE;
+}
@@ -16,61 +16,288 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _XOPEN_SOURCE 700
+
 #include "asm/section.h"
+#include "asm/section_private.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "alloc.h"
+#include "arena.h"
+#include "stats.h"
 
 
-section_t *section_alloc(size_t siz)
+section_t *section_alloc(size_t siz, arena_t *arena)
 {
-	section_t *tmp = malloc(sizeof(section_t));
+	if (arena) {
+		section_t *tmp = arena_malloc(arena, sizeof(section_t));
+		if (!tmp) return NULL;
+
+		tmp->instr = arena_malloc(arena, sizeof(instruction_t) * siz);
+		if (!tmp->instr) return NULL;
+
+		tmp->cnt   = 0;
+		tmp->siz   = siz;
+		tmp->arena = arena;
+		tmp->known = 0;
+
+		return tmp;
+	}
+
+	section_t *tmp = alloc_malloc(sizeof(section_t));
 	if (!tmp) return NULL;
 
-	tmp->instr = malloc(sizeof(instruction_t) * siz);
+	tmp->instr = alloc_malloc(sizeof(instruction_t) * siz);
 	if (!tmp->instr) goto error;
 
-	tmp->cnt = 0;
-	tmp->siz = siz;
+	tmp->cnt   = 0;
+	tmp->siz   = siz;
+	tmp->arena = NULL;
+	tmp->known = 0;
 
 	return tmp;
 
 error:
-	free(tmp);
+	alloc_free(tmp);
 	return NULL;
 }
 
+int section_emit(section_t *sec, const instruction_t *instr, size_t cnt)
+{
+	size_t siz = sec->siz;
+
+	while (sec->cnt + cnt > siz) siz *= 2;
+
+	if (siz > sec->siz && section_realloc(sec, siz) < 0) return -1;
+
+	memcpy(sec->instr + sec->cnt, instr, cnt * sizeof(instruction_t));
+	sec->cnt += cnt;
+
+	for (size_t i = 0; i < cnt; i++) track(sec, instr[i]);
+
+	return 0;
+}
+
+void section_forget(section_t *sec)
+{
+	sec->known = 0;
+}
+
 void section_free(section_t *sec)
 {
-	if (!sec) return;
+	if (!sec || sec->arena) return;
+
+	alloc_free(sec->instr);
+	alloc_free(sec);
+}
+
+int section_load(section_t *sec, uint8_t val)
+{
+	instruction_t instr[2];
+	size_t        cnt   = 1;
+	uint8_t       known = sec->known;
+	uint8_t       acc   = sec->acc;
+
+	// already there, nothing to reload
+	if (known == 0xff && acc == val) return 0;
+
+	if (!val)
+		instr[0] = INSTR(AND, Z);
+	else if ((known & 0xf0) == 0xf0 && !((acc ^ val) & 0xf0))
+		instr[0] = INSTR(LNL, val & 0xf);
+	else if ((known & 0x0f) == 0x0f && !((acc ^ val) & 0x0f))
+		instr[0] = INSTR(LNH, val >> 4);
+	else if (known != 0xff || !derive(acc, val, instr)) {
+		instr[0] = INSTR(LNL, val & 0xf);
+		instr[1] = INSTR(LNH, val >> 4);
+		cnt      = 2;
+	}
 
-	free(sec->instr);
-	free(sec);
+	return section_emit(sec, instr, cnt);
 }
 
 int section_realloc(section_t *sec, size_t siz)
 {
-	instruction_t *tmp = realloc(sec->instr, sizeof(instruction_t) * siz);
+	instruction_t *tmp;
+
+	if (sec->arena)
+		tmp = arena_realloc(
+			sec->arena,
+			sec->instr,
+			sizeof(instruction_t) * sec->siz,
+			sizeof(instruction_t) * siz
+		);
+	else
+		tmp = alloc_realloc(sec->instr, sizeof(instruction_t) * siz);
+
 	if (!tmp) return -1;
 
 	sec->instr = tmp;
 	sec->siz   = siz;
 
+	++stats_thread.section_reallocs;
+
 	return 0;
 }
 
-uint8_t *section_to_bin(const section_t *sec)
+int section_writev(int fd, const section_t **secs, size_t cnt)
 {
-	uint8_t *bin = malloc(sizeof(uint8_t) * sec->cnt);
-	if (!bin) return NULL;
-
-	const instruction_t *instr = sec->instr;
-	for (size_t i = 0; i < sec->cnt; i++) {
-		bin[i]  = instr->opcode << 4;
-		bin[i] |= instr->operand;
-		++instr;
+	struct iovec  iov[SECTION_IOVCNT];
+	struct iovec *pos = iov;
+
+	if (cnt > SECTION_IOVCNT || cnt > IOV_MAX) return -1;
+
+	// the encoded bytes go straight from each section to the kernel
+	for (size_t i = 0; i < cnt; i++) {
+		iov[i].iov_base = secs[i]->instr;
+		iov[i].iov_len  = secs[i]->cnt * sizeof(instruction_t);
+	}
+
+	while (cnt) {
+		ssize_t ret = writev(fd, pos, cnt);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		// resume a partial write where it stopped
+		size_t len = ret;
+		while (cnt && len >= pos->iov_len) {
+			len -= pos->iov_len;
+			++pos;
+			--cnt;
+		}
+
+		if (cnt) {
+			pos->iov_base  = (uint8_t *) pos->iov_base + len;
+			pos->iov_len  -= len;
+		}
+	}
+
+	return 0;
+}
+
+
+static bool derive(uint8_t acc, uint8_t val, instruction_t *instr)
+{
+	// a single instruction reaching val from a known accumulator
+	if ((uint8_t) -acc == val) {
+		*instr = INSTR(NEG, A);
+		return true;
+	}
+
+	for (unsigned i = 1; i <= SECTION_SHIFTMAX; i++) {
+		if ((uint8_t) (acc << i) == val) {
+			*instr = INSTR(LSL, i);
+			return true;
+		}
+
+		if ((uint8_t) (acc >> i) == val) {
+			*instr = INSTR(LSR, i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void track(section_t *sec, instruction_t instr)
+{
+	unsigned op      = INSTR_OPCODE(instr);
+	unsigned operand = INSTR_OPERAND(instr);
+	uint8_t  known   = sec->known;
+	uint8_t  acc     = sec->acc & known;
+
+	switch (op) {
+		case ADD:
+		case SUB:
+		case EOR:
+			if (operand == Z) break;
+
+			if (operand == A && op != ADD) {
+				known = 0xff;
+				acc   = 0;
+			} else if (operand == A) {
+				known = known << 1 | 1;
+				acc   = acc << 1;
+			} else {
+				known = 0;
+			}
+			break;
+
+		case NEG:
+			if (operand == Z) {
+				known = 0xff;
+				acc   = 0;
+			} else if (operand == A && known == 0xff) {
+				acc = -acc;
+			} else {
+				known = 0;
+			}
+			break;
+
+		case AND:
+			if (operand == A) break;
+
+			// only bits known to be clear survive
+			known = (operand == Z) ? 0xff : known & ~acc;
+			acc   = 0;
+			break;
+
+		case ORR:
+			if (operand == A || operand == Z) break;
+
+			// only bits known to be set survive
+			known &= acc;
+			break;
+
+		case LSL:
+			if (operand > SECTION_SHIFTMAX) {
+				known = 0;
+				break;
+			}
+
+			known = known << operand | ((1u << operand) - 1);
+			acc   = acc << operand;
+			break;
+
+		case LSR:
+			if (operand > SECTION_SHIFTMAX) {
+				known = 0;
+				break;
+			}
+
+			known = known >> operand | ~(0xffu >> operand);
+			acc   = acc >> operand;
+			break;
+
+		case LNL:
+			known |= 0x0f;
+			acc    = (acc & 0xf0) | operand;
+			break;
+
+		case LNH:
+			known |= 0xf0;
+			acc    = (acc & 0x0f) | operand << 4;
+			break;
+
+		case MVA:
+			break;
+
+		// memory, other registers and jumps leave nothing certain
+		default:
+			known = 0;
+			break;
 	}
 
-	return bin;
+	sec->known = known;
+	sec->acc   = acc & known;
 }
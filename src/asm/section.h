@@ -24,6 +24,11 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "arena.h"
+
+
+// sections written per writev() call
+#define SECTION_IOVCNT 1024
 
 enum opcodes {
 	ADD,  // add
@@ -70,22 +75,32 @@ enum registers_16bit {
 	KL,  // kl register
 };
 
-typedef struct instruction_s {
-	unsigned opcode  : 4;
-	unsigned operand : 4;
-} instruction_t;
+// instructions are stored as their final encoded byte
+typedef uint8_t instruction_t;
+
+#define INSTR(opcode, operand) ((instruction_t) ((opcode) << 4 | (operand)))
+#define INSTR_OPCODE(instr)    ((unsigned) (instr) >> 4)
+#define INSTR_OPERAND(instr)   ((unsigned) (instr) & 0xf)
 
 typedef struct section_s {
 	instruction_t *instr;
 	size_t         cnt;
 	size_t         siz;
+	arena_t       *arena;  // backs the section when set
+	uint8_t        known;  // accumulator bits known after the last instruction
+	uint8_t        acc;    // and their values
 } section_t;
 
 
-section_t *section_alloc(size_t siz);
+section_t *section_alloc(size_t siz, arena_t *arena);
+int        section_emit(section_t *sec, const instruction_t *instr, size_t cnt);
+// control may arrive from elsewhere, nothing is known about the accumulator
+void       section_forget(section_t *sec);
 void       section_free(section_t *sec);
+// loads val into the accumulator in as few instructions as it can
+int        section_load(section_t *sec, uint8_t val);
 int        section_realloc(section_t *sec, size_t siz);
-uint8_t   *section_to_bin(const section_t *sec);
+int        section_writev(int fd, const section_t **secs, size_t cnt);
 
 
 #endif /* JAVK_AS_ASM_SECTION */
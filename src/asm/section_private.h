@@ -0,0 +1,36 @@
+/*
+ * section_private.h -- instruction sections
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_SECTION_PRIVATE
+#define JAVK_AS_ASM_SECTION_PRIVATE
+
+
+#include "asm/section.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define SECTION_SHIFTMAX 7  // widest shift with a well defined result
+
+
+static bool derive(uint8_t acc, uint8_t val, instruction_t *instr);
+static void track(section_t *sec, instruction_t instr);
+
+
+#endif /* JAVK_AS_ASM_SECTION_PRIVATE */
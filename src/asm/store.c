@@ -0,0 +1,251 @@
+/*
+ * store.c -- on-disk section store
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include "asm/store.h"
+#include "asm/store_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "asm/parser.h"
+#include "asm/peephole.h"
+#include "asm/section.h"
+#include "asm/unit.h"
+#include "ht.h"
+
+
+int store_get(const char *dir, const char *text, size_t len, unsigned opt, unit_t *unit)
+{
+	char     buf[PATH_MAX];
+	uint64_t ver = seed(opt);
+
+	if (path(buf, sizeof(buf), dir, text, len, ver) < 0) return -1;
+
+	int fd = open(buf, O_RDONLY);
+	if (fd < 0) return -1;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(store_hdr_t)) {
+		close(fd);
+		return -1;
+	}
+
+	size_t siz = st.st_size;
+	void  *map = mmap(NULL, siz, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return -1;
+
+	const store_hdr_t *hdr  = map;
+	size_t             body = siz - sizeof(store_hdr_t);
+
+	// a truncated, foreign or colliding entry is just a miss
+	if (hdr->magic != STORE_MAGIC
+		|| hdr->format != STORE_FORMAT
+		|| hdr->seed != ver
+		|| hdr->word != sizeof(size_t)
+		|| hdr->text_len != len
+		|| hdr->defs_cnt > body / sizeof(unit_def_t)
+		|| hdr->refs_cnt > body / sizeof(unit_ref_t)
+		|| hdr->stream_cnt > body
+		|| hdr->names_cnt > body
+	) goto error;
+
+	size_t tabs = hdr->defs_cnt * sizeof(unit_def_t)
+		+ hdr->refs_cnt * sizeof(unit_ref_t);
+
+	if (tabs > body || body - tabs != len + hdr->stream_cnt + hdr->names_cnt)
+		goto error;
+
+	const unit_def_t    *defs  = (const unit_def_t *) (hdr + 1);
+	const unit_ref_t    *refs  = (const unit_ref_t *) (defs + hdr->defs_cnt);
+	const char          *str   = (const char *) (refs + hdr->refs_cnt);
+	const instruction_t *instr = (const instruction_t *) (str + len);
+	const char          *names = (const char *) (instr + hdr->stream_cnt);
+
+	if (memcmp(str, text, len)) goto error;
+	if (hdr->names_cnt && names[hdr->names_cnt - 1]) goto error;
+
+	// the leading instructions come first, then sections in stream order
+	size_t start = (hdr->defs_cnt) ? defs[0].off : hdr->stream_cnt;
+	if (hdr->lead > start) goto error;
+
+	unit_reset(unit);
+
+	if (section_emit(unit->stream, instr, hdr->stream_cnt) < 0) goto error;
+
+	for (size_t i = 0; i < hdr->defs_cnt; i++) {
+		if (defs[i].name >= hdr->names_cnt) goto error;
+		if (defs[i].off > hdr->stream_cnt) goto error;
+		if (i && defs[i].off < defs[i - 1].off) goto error;
+
+		if (unit_define(unit, names + defs[i].name, defs[i].off, defs[i].line) < 0)
+			goto error;
+	}
+
+	// linking patches a whole expansion at every reference
+	for (size_t i = 0; i < hdr->refs_cnt; i++) {
+		if (refs[i].name >= hdr->names_cnt) goto error;
+		if (hdr->stream_cnt < JUMP_LEN) goto error;
+		if (refs[i].off > hdr->stream_cnt - JUMP_LEN) goto error;
+		if (i && refs[i].off < refs[i - 1].off) goto error;
+
+		if (unit_refer(unit, names + refs[i].name, refs[i].off, refs[i].line) < 0)
+			goto error;
+	}
+
+	unit->lead = hdr->lead;
+	unit->line = hdr->line;
+
+	munmap(map, siz);
+
+	return 0;
+
+error:
+	munmap(map, siz);
+	unit_reset(unit);
+	return -1;
+}
+
+int store_put(const char *dir, const char *text, size_t len, unsigned opt, const unit_t *unit)
+{
+	char     buf[PATH_MAX];
+	char     tmp[PATH_MAX];
+	uint64_t ver = seed(opt);
+
+	if (path(buf, sizeof(buf), dir, text, len, ver) < 0) return -1;
+
+	// make the store and the fan-out directory on first use
+	char *slash = strrchr(buf, '/');
+	*slash = '\0';
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST) return -1;
+	if (mkdir(buf, 0777) < 0 && errno != EEXIST) return -1;
+
+	int ret = snprintf(tmp, sizeof(tmp), "%s/.tmp-XXXXXX", buf);
+	if (ret < 0 || (size_t) ret >= sizeof(tmp)) return -1;
+	*slash = '/';
+
+	int fd = mkstemp(tmp);
+	if (fd < 0) return -1;
+
+	store_hdr_t hdr = {
+		.magic      = STORE_MAGIC,
+		.format     = STORE_FORMAT,
+		.seed       = ver,
+		.word       = sizeof(size_t),
+		.text_len   = len,
+		.stream_cnt = unit->stream->cnt,
+		.defs_cnt   = unit->defs_cnt,
+		.refs_cnt   = unit->refs_cnt,
+		.names_cnt  = unit->names_cnt,
+		.lead       = unit->lead,
+		.line       = unit->line,
+	};
+
+	struct iovec iov[STORE_IOVCNT] = {
+		{&hdr,                 sizeof(hdr)},
+		{unit->defs,           unit->defs_cnt * sizeof(unit_def_t)},
+		{unit->refs,           unit->refs_cnt * sizeof(unit_ref_t)},
+		{(char *) text,        len},
+		{unit->stream->instr,  unit->stream->cnt * sizeof(instruction_t)},
+		{unit->names,          unit->names_cnt},
+	};
+
+	// readers only ever see complete entries
+	if (writeall(fd, iov, STORE_IOVCNT) < 0 || close(fd) < 0) {
+		unlink(tmp);
+		return -1;
+	}
+
+	if (rename(tmp, buf) < 0) {
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int path(char *buf, size_t siz, const char *dir, const char *text, size_t len, uint64_t seed)
+{
+	uint64_t hash = ht_hash_wy(text, len, seed);
+
+	int ret = snprintf(
+		buf,
+		siz,
+		"%s/%02x/%014llx-%llx",
+		dir,
+		(unsigned) (hash >> 56),
+		(unsigned long long) (hash & UINT64_C(0xffffffffffffff)),
+		(unsigned long long) len
+	);
+
+	return (ret < 0 || (size_t) ret >= siz) ? -1 : 0;
+}
+
+static uint64_t seed(unsigned opt)
+{
+	static const char version[] = JAVK_AS_VERSION;
+
+	// anything that changes what a text encodes to is part of the key,
+	// optimized and plain encodings of the same text are distinct entries
+	uint64_t rev[] = {
+		STORE_FORMAT,
+		PARSER_REVISION,
+		opt,
+		(opt) ? peephole_revision() : 0,
+	};
+
+	return ht_hash_wy(version, sizeof(version) - 1, ht_hash_wy(rev, sizeof(rev), 0));
+}
+
+static int writeall(int fd, struct iovec *iov, int cnt)
+{
+	while (cnt) {
+		ssize_t ret = writev(fd, iov, cnt);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		size_t len = ret;
+		while (cnt && len >= iov->iov_len) {
+			len -= iov->iov_len;
+			++iov;
+			--cnt;
+		}
+
+		if (cnt) {
+			iov->iov_base  = (uint8_t *) iov->iov_base + len;
+			iov->iov_len  -= len;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * store.h -- on-disk section store
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_STORE
+#define JAVK_AS_ASM_STORE
+
+
+#include <stddef.h>
+
+#include "asm/unit.h"
+
+
+#define STORE_FORMAT 2  // bump whenever the entry layout changes
+
+
+// entries are keyed on the section text, the assembler version, the encoder
+// revisions and whether the peephole pass ran, so a store is safe to share
+// between processes and versions
+int store_get(const char *dir, const char *text, size_t len, unsigned opt, unit_t *unit);
+int store_put(const char *dir, const char *text, size_t len, unsigned opt, const unit_t *unit);
+
+
+#endif /* JAVK_AS_ASM_STORE */
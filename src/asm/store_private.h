@@ -0,0 +1,60 @@
+/*
+ * store_private.h -- on-disk section store
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_STORE_PRIVATE
+#define JAVK_AS_ASM_STORE_PRIVATE
+
+
+#include "asm/store.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "asm/unit.h"
+
+
+#define STORE_MAGIC  UINT32_C(0x4341564a)  // "JVAC", also catches byte order
+#define STORE_IOVCNT 6
+
+#ifndef JAVK_AS_VERSION
+#define JAVK_AS_VERSION "unknown"
+#endif
+
+
+typedef struct store_hdr_s {
+	uint32_t magic;
+	uint32_t format;
+	uint64_t seed;       // of the assembler version and encoder revisions
+	uint64_t word;       // sizeof(size_t) the entry was written with
+	uint64_t text_len;
+	uint64_t stream_cnt;
+	uint64_t defs_cnt;
+	uint64_t refs_cnt;
+	uint64_t names_cnt;
+	uint64_t lead;
+	uint64_t line;
+} store_hdr_t;
+
+
+static int      path(char *buf, size_t siz, const char *dir, const char *text, size_t len, uint64_t seed);
+static uint64_t seed(unsigned opt);
+static int      writeall(int fd, struct iovec *iov, int cnt);
+
+
+#endif /* JAVK_AS_ASM_STORE_PRIVATE */
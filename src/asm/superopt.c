@@ -0,0 +1,607 @@
+/*
+ * superopt.c -- exhaustive search for accumulator rewrites
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "asm/section.h"
+#include "asm/superopt.h"
+#include "ht.h"
+
+
+#define SUPEROPT_LANES  256  // one per accumulator value
+#define SUPEROPT_WORDS  (SUPEROPT_LANES / 64)
+#define SUPEROPT_JOBSMAX 1024
+
+
+// the accumulator for every input at once, bit-sliced: bit j of plane p
+// is bit p of the result for an input of j
+typedef struct fn_s {
+	uint64_t plane[8][SUPEROPT_WORDS];
+} fn_t;
+
+// the first shortest sequence found for a function
+typedef struct node_s {
+	fn_t          fn;
+	size_t        len;
+	instruction_t seq[SUPEROPT_MAXLEN];
+} node_t;
+
+typedef struct cand_s {
+	fn_t           fn;
+	const node_t  *parent;
+	instruction_t  instr;
+} cand_t;
+
+typedef struct level_s {
+	node_t **node;
+	size_t   cnt;
+	size_t   siz;
+} level_t;
+
+typedef struct job_s {
+	pthread_t  thread;
+	bool       spawned;
+	size_t     first;
+	size_t     last;
+	cand_t    *cand;
+	size_t     cand_cnt;
+	size_t     cand_siz;
+	int        ret;
+} job_t;
+
+typedef struct rule_s {
+	superopt_t *ent;
+	size_t      cnt;
+	size_t      siz;
+} rule_t;
+
+
+static instruction_t  alphabet[64];
+static size_t         alphabet_cnt;
+static ht_t          *seen;
+static const level_t *frontier;
+static size_t         maxlen;
+static rule_t        *rules;     // one list per first instruction
+static size_t         next_rule;
+static pthread_mutex_t next_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void build_alphabet(void)
+{
+	static const unsigned ops[] = {AND, NEG, ADD, SUB, EOR};
+
+	// ties go to whatever comes first, so shifts, nibble loads and AND Z
+	// lead the way they do in hand-written code
+	for (unsigned i = 0; i < 8; i++) alphabet[alphabet_cnt++] = INSTR(LSL, i);
+	for (unsigned i = 0; i < 8; i++) alphabet[alphabet_cnt++] = INSTR(LSR, i);
+	for (unsigned i = 0; i < 16; i++) alphabet[alphabet_cnt++] = INSTR(LNL, i);
+	for (unsigned i = 0; i < 16; i++) alphabet[alphabet_cnt++] = INSTR(LNH, i);
+
+	// only instructions reading nothing but the accumulator and Z, ORR Z
+	// is left out since it spells NOP, shifts past 7 are left undefined
+	for (size_t i = 0; i < sizeof(ops) / sizeof(*ops); i++) {
+		alphabet[alphabet_cnt++] = INSTR(ops[i], Z);
+		alphabet[alphabet_cnt++] = INSTR(ops[i], A);
+	}
+
+	alphabet[alphabet_cnt++] = INSTR(ORR, A);
+}
+
+static void identity(fn_t *fn)
+{
+	memset(fn, 0, sizeof(*fn));
+
+	for (unsigned j = 0; j < SUPEROPT_LANES; j++)
+		for (unsigned p = 0; p < 8; p++)
+			if (j >> p & 1) fn->plane[p][j / 64] |= UINT64_C(1) << (j % 64);
+}
+
+static void apply(fn_t *dst, const fn_t *in, instruction_t instr)
+{
+	unsigned op      = INSTR_OPCODE(instr);
+	unsigned operand = INSTR_OPERAND(instr);
+	bool     zero    = false;
+
+	// dst may well be in
+	const fn_t  copy = *in;
+	const fn_t *src  = &copy;
+
+	*dst = copy;
+
+	switch (op) {
+		case ADD:
+			if (operand == Z) break;
+
+			// a + a is a shift by one
+			for (unsigned p = 8; p-- > 1;)
+				memcpy(dst->plane[p], src->plane[p - 1], sizeof(*dst->plane));
+			memset(dst->plane[0], 0, sizeof(*dst->plane));
+			break;
+
+		case SUB:
+		case EOR:
+			zero = operand == A;
+			break;
+
+		case NEG:
+			if (operand == Z) {
+				zero = true;
+				break;
+			}
+
+			// invert and add one, rippling the carry up the planes
+			for (unsigned w = 0; w < SUPEROPT_WORDS; w++) {
+				uint64_t carry = ~UINT64_C(0);
+
+				for (unsigned p = 0; p < 8; p++) {
+					uint64_t bit = ~src->plane[p][w];
+
+					dst->plane[p][w] = bit ^ carry;
+					carry &= bit;
+				}
+			}
+			break;
+
+		case AND:
+			zero = operand == Z;
+			break;
+
+		case ORR:
+			break;
+
+		case LSL:
+			for (unsigned p = 0; p < 8; p++) {
+				if (p >= operand)
+					memcpy(dst->plane[p], src->plane[p - operand], sizeof(*dst->plane));
+				else
+					memset(dst->plane[p], 0, sizeof(*dst->plane));
+			}
+			break;
+
+		case LSR:
+			for (unsigned p = 0; p < 8; p++) {
+				if (p + operand < 8)
+					memcpy(dst->plane[p], src->plane[p + operand], sizeof(*dst->plane));
+				else
+					memset(dst->plane[p], 0, sizeof(*dst->plane));
+			}
+			break;
+
+		case LNL:
+		case LNH:
+			for (unsigned p = 0; p < 4; p++) {
+				unsigned plane = (op == LNL) ? p : p + 4;
+				uint64_t fill  = (operand >> p & 1) ? ~UINT64_C(0) : 0;
+
+				for (unsigned w = 0; w < SUPEROPT_WORDS; w++)
+					dst->plane[plane][w] = fill;
+			}
+			break;
+	}
+
+	if (zero) memset(dst, 0, sizeof(*dst));
+}
+
+static size_t shortest(const fn_t *fn, size_t len)
+{
+	const node_t *node = ht_get(seen, fn, sizeof(*fn));
+
+	// everything up to maxlen - 1 instructions long has been seen
+	return (node) ? node->len : len;
+}
+
+static int push_cand(job_t *job, const fn_t *fn, const node_t *parent, instruction_t instr)
+{
+	if (job->cand_cnt == job->cand_siz) {
+		size_t  siz = (job->cand_siz) ? job->cand_siz * 2 : 256;
+		cand_t *tmp = realloc(job->cand, siz * sizeof(*tmp));
+		if (!tmp) return -1;
+
+		job->cand     = tmp;
+		job->cand_siz = siz;
+	}
+
+	cand_t *cand = job->cand + job->cand_cnt++;
+
+	cand->fn     = *fn;
+	cand->parent = parent;
+	cand->instr  = instr;
+
+	return 0;
+}
+
+static void *expand(void *arg)
+{
+	job_t *job = arg;
+	fn_t   fn;
+
+	// the table is only read while the jobs run
+	for (size_t i = job->first; i < job->last; i++) {
+		const node_t *node = frontier->node[i];
+
+		for (size_t a = 0; a < alphabet_cnt; a++) {
+			apply(&fn, &node->fn, alphabet[a]);
+			if (ht_get(seen, &fn, sizeof(fn))) continue;
+
+			if (push_cand(job, &fn, node, alphabet[a]) < 0) {
+				job->ret = -1;
+				return NULL;
+			}
+		}
+	}
+
+	job->ret = 0;
+	return NULL;
+}
+
+static int push_node(level_t *level, node_t *node)
+{
+	if (level->cnt == level->siz) {
+		size_t   siz = (level->siz) ? level->siz * 2 : 256;
+		node_t **tmp = realloc(level->node, siz * sizeof(*tmp));
+		if (!tmp) return -1;
+
+		level->node = tmp;
+		level->siz  = siz;
+	}
+
+	level->node[level->cnt++] = node;
+
+	return 0;
+}
+
+static void run(void *(*fn)(void *), job_t *jobs, unsigned cnt)
+{
+	for (unsigned i = 1; i < cnt; i++)
+		jobs[i].spawned = !pthread_create(&jobs[i].thread, NULL, fn, jobs + i);
+
+	// the calling thread takes the first job and any that failed to spawn
+	for (unsigned i = 0; i < cnt; i++)
+		if (!i || !jobs[i].spawned) fn(jobs + i);
+
+	for (unsigned i = 1; i < cnt; i++)
+		if (jobs[i].spawned) pthread_join(jobs[i].thread, NULL);
+}
+
+static int search(arena_t *arena, job_t *jobs, unsigned cnt)
+{
+	level_t prev = {0};
+	level_t next = {0};
+
+	node_t *root = arena_malloc(arena, sizeof(node_t));
+	if (!root) return -1;
+
+	identity(&root->fn);
+	root->len = 0;
+
+	if (ht_set(seen, &root->fn, sizeof(root->fn), root) < 0) return -1;
+	if (push_node(&prev, root) < 0) return -1;
+
+	// breadth first, so the first sequence reaching a function is shortest
+	for (size_t len = 1; len < maxlen; len++) {
+		frontier = &prev;
+
+		for (unsigned i = 0; i < cnt; i++) {
+			jobs[i].first    = prev.cnt * i / cnt;
+			jobs[i].last     = prev.cnt * (i + 1) / cnt;
+			jobs[i].cand_cnt = 0;
+		}
+
+		run(expand, jobs, cnt);
+
+		// merging in job order keeps the output reproducible
+		next.cnt = 0;
+		for (unsigned i = 0; i < cnt; i++) {
+			if (jobs[i].ret < 0) return -1;
+
+			for (size_t c = 0; c < jobs[i].cand_cnt; c++) {
+				const cand_t *cand = jobs[i].cand + c;
+				if (ht_get(seen, &cand->fn, sizeof(cand->fn))) continue;
+
+				node_t *node = arena_malloc(arena, sizeof(node_t));
+				if (!node) return -1;
+
+				node->fn  = cand->fn;
+				node->len = len;
+				memcpy(node->seq, cand->parent->seq, len - 1);
+				node->seq[len - 1] = cand->instr;
+
+				if (ht_set(seen, &node->fn, sizeof(node->fn), node) < 0) return -1;
+				if (push_node(&next, node) < 0) return -1;
+			}
+		}
+
+		fprintf(stderr, "javk-superopt: %zu functions of length %zu\n", next.cnt, len);
+
+		level_t tmp = prev;
+		prev = next;
+		next = tmp;
+	}
+
+	free(prev.node);
+	free(next.node);
+
+	return 0;
+}
+
+static int push_rule(rule_t *rule, const instruction_t *win, size_t len, const node_t *node)
+{
+	if (rule->cnt == rule->siz) {
+		size_t      siz = (rule->siz) ? rule->siz * 2 : 64;
+		superopt_t *tmp = realloc(rule->ent, siz * sizeof(*tmp));
+		if (!tmp) return -1;
+
+		rule->ent = tmp;
+		rule->siz = siz;
+	}
+
+	superopt_t *ent = rule->ent + rule->cnt++;
+
+	ent->key  = superopt_pack(win, len);
+	ent->rep  = superopt_pack(node->seq, node->len);
+	ent->len  = len;
+	ent->rlen = node->len;
+
+	return 0;
+}
+
+static int walk(rule_t *rule, instruction_t *win, size_t len, const fn_t *fn)
+{
+	const node_t *node = ht_get(seen, fn, sizeof(*fn));
+
+	if (node && node->len < len) {
+		fn_t suffix;
+
+		// the pass rewrites as it goes, so a window is only reached
+		// when what precedes its last instruction is already optimal
+		identity(&suffix);
+		for (size_t i = 1; i < len; i++) apply(&suffix, &suffix, win[i]);
+
+		if (shortest(&suffix, len - 1) < len - 1) return 0;
+
+		return push_rule(rule, win, len, node);
+	}
+
+	// any longer window starting here would have been cut short above,
+	// maxlen never exceeds SUPEROPT_MAXLEN but the compiler can't tell
+	if (len >= maxlen || len >= SUPEROPT_MAXLEN) return 0;
+
+	for (size_t a = 0; a < alphabet_cnt; a++) {
+		fn_t next;
+
+		win[len] = alphabet[a];
+		apply(&next, fn, alphabet[a]);
+
+		if (walk(rule, win, len + 1, &next) < 0) return -1;
+	}
+
+	return 0;
+}
+
+static void *enumerate(void *arg)
+{
+	job_t *job = arg;
+
+	for (;;) {
+		pthread_mutex_lock(&next_lock);
+		size_t a = next_rule++;
+		pthread_mutex_unlock(&next_lock);
+
+		if (a >= alphabet_cnt) break;
+
+		instruction_t win[SUPEROPT_MAXLEN];
+		fn_t          fn;
+
+		identity(&fn);
+		win[0] = alphabet[a];
+		apply(&fn, &fn, win[0]);
+
+		if (walk(rules + a, win, 1, &fn) < 0) {
+			job->ret = -1;
+			return NULL;
+		}
+	}
+
+	job->ret = 0;
+	return NULL;
+}
+
+static int compare(const void *a, const void *b)
+{
+	const superopt_t *x = a;
+	const superopt_t *y = b;
+
+	if (x->len != y->len) return (x->len < y->len) ? -1 : 1;
+	if (x->key != y->key) return (x->key < y->key) ? -1 : 1;
+
+	return 0;
+}
+
+static int emit(FILE *stream)
+{
+	size_t total = 0;
+
+	for (size_t a = 0; a < alphabet_cnt; a++) total += rules[a].cnt;
+
+	superopt_t *all = malloc((total + 1) * sizeof(*all));
+	if (!all) return -1;
+
+	total = 0;
+	for (size_t a = 0; a < alphabet_cnt; a++) {
+		memcpy(all + total, rules[a].ent, rules[a].cnt * sizeof(*all));
+		total += rules[a].cnt;
+	}
+
+	qsort(all, total, sizeof(*all), compare);
+
+	// lets a lookup give up at the first instruction no window holds
+	uint8_t member[256 / 8] = {0};
+	for (size_t a = 0; a < alphabet_cnt; a++)
+		member[alphabet[a] / 8] |= 1u << alphabet[a] % 8;
+
+	// identifies the table in --cache-dir keys, see peephole_revision()
+	uint64_t hash = ht_hash_wy(member, sizeof(member), maxlen);
+	for (size_t i = 0; i < total; i++) {
+		uint64_t ent[] = {all[i].key, all[i].rep, all[i].len, all[i].rlen};
+
+		hash = ht_hash_wy(ent, sizeof(ent), hash);
+	}
+
+	fprintf(
+		stream,
+		"/* generated by javk-superopt -n %zu, do not edit */\n"
+		"\n"
+		"#ifndef JAVK_AS_ASM_SUPEROPT_TABLE\n"
+		"#define JAVK_AS_ASM_SUPEROPT_TABLE\n"
+		"\n"
+		"\n"
+		"#include \"asm/superopt.h\"\n"
+		"\n"
+		"\n"
+		"#define SUPEROPT_TABLE_LEN %zu\n"
+		"#define SUPEROPT_TABLE_CNT %zu\n"
+		"#define SUPEROPT_TABLE_HASH UINT64_C(0x%016llx)\n"
+		"\n",
+		maxlen,
+		maxlen,
+		total,
+		(unsigned long long) hash
+	);
+
+	fputs("static const uint8_t superopt_alphabet[] = {", stream);
+	for (size_t i = 0; i < sizeof(member); i++)
+		fprintf(stream, "%s0x%02x,", (i % 8) ? " " : "\n\t", member[i]);
+	fputs("\n};\n\nstatic const superopt_t superopt_table[] = {\n", stream);
+
+	for (size_t i = 0; i < total; i++)
+		fprintf(
+			stream,
+			"\t{UINT64_C(0x%0*llx), UINT64_C(0x%llx), %u, %u},\n",
+			all[i].len * 2,
+			(unsigned long long) all[i].key,
+			(unsigned long long) all[i].rep,
+			all[i].len,
+			all[i].rlen
+		);
+
+	// never empty, a lone ADD Z always goes
+	fputs("};\n\n#endif /* JAVK_AS_ASM_SUPEROPT_TABLE */\n", stream);
+
+	fprintf(stderr, "javk-superopt: %zu rewrites\n", total);
+
+	free(all);
+
+	return 0;
+}
+
+static void usage(FILE *stream)
+{
+	fputs(
+		"usage: javk-superopt [-j jobs] [-n len] output\n"
+		"\n"
+		"  -j N  search on N threads (default: 1)\n"
+		"  -n N  rewrite windows of up to N instructions (default: 3)\n",
+		stream
+	);
+}
+
+static int parse(const char *arg, unsigned long max, unsigned long *val)
+{
+	char *end;
+
+	*val = strtoul(arg, &end, 10);
+
+	return (!*arg || *end || !*val || *val > max) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long  jobs   = 1;
+	unsigned long  len    = 3;
+	const char    *output = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+			if (parse(argv[++i], SUPEROPT_JOBSMAX, &jobs) < 0) goto usage;
+		} else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			if (parse(argv[++i], SUPEROPT_MAXLEN, &len) < 0) goto usage;
+		} else if (!output && argv[i][0] != '-') {
+			output = argv[i];
+		} else {
+			goto usage;
+		}
+	}
+
+	if (!output) goto usage;
+
+	maxlen = len;
+	build_alphabet();
+
+	int      ret   = EXIT_FAILURE;
+	arena_t *arena = arena_alloc();
+	job_t   *job   = calloc(jobs, sizeof(job_t));
+
+	seen  = ht_alloc(NULL, NULL, HT_NOCOPY);
+	rules = calloc(alphabet_cnt, sizeof(rule_t));
+	if (!arena || !job || !seen || !rules) goto error;
+
+	if (search(arena, job, jobs) < 0) goto error;
+
+	run(enumerate, job, jobs);
+
+	for (unsigned i = 0; i < jobs; i++)
+		if (job[i].ret < 0) goto error;
+
+	FILE *stream = fopen(output, "w");
+	if (!stream) {
+		perror(output);
+		goto error;
+	}
+
+	if (emit(stream) < 0 || fclose(stream)) {
+		perror(output);
+		remove(output);
+		goto error;
+	}
+
+	ret = EXIT_SUCCESS;
+
+error:
+	if (ret != EXIT_SUCCESS) fputs("javk-superopt: search failed\n", stderr);
+
+	for (size_t a = 0; rules && a < alphabet_cnt; a++) free(rules[a].ent);
+	for (unsigned i = 0; job && i < jobs; i++) free(job[i].cand);
+
+	free(rules);
+	free(job);
+	ht_free(seen, NULL);
+	arena_free(arena);
+
+	return ret;
+
+usage:
+	usage(stderr);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,64 @@
+/*
+ * superopt.h -- superoptimized rewrites
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_SUPEROPT
+#define JAVK_AS_ASM_SUPEROPT
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm/section.h"
+
+
+#define SUPEROPT_MAXLEN 8
+
+
+// an accumulator-only window and its shortest equivalent, both packed by
+// superopt_pack(), tables are sorted by len and then key
+typedef struct superopt_s {
+	uint64_t key;
+	uint64_t rep;
+	uint8_t  len;
+	uint8_t  rlen;
+} superopt_t;
+
+
+static inline bool superopt_member(const uint8_t *alphabet, instruction_t instr)
+{
+	return alphabet[instr / 8] >> instr % 8 & 1;
+}
+
+// the first instruction ends up in the most significant byte
+static inline uint64_t superopt_pack(const instruction_t *instr, size_t len)
+{
+	uint64_t word = 0;
+
+	for (size_t i = 0; i < len; i++) word = word << 8 | instr[i];
+
+	return word;
+}
+
+static inline void superopt_unpack(uint64_t word, size_t len, instruction_t *instr)
+{
+	for (size_t i = len; i-- > 0; word >>= 8) instr[i] = word & 0xff;
+}
+
+
+#endif /* JAVK_AS_ASM_SUPEROPT */
@@ -0,0 +1,149 @@
+/*
+ * unit.c -- encoded source fragments
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "asm/unit.h"
+#include "asm/unit_private.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm/section.h"
+#include "alloc.h"
+#include "javk-as.h"
+
+
+unit_t *unit_alloc(bool cont, size_t siz)
+{
+	unit_t *tmp = alloc_calloc(1, sizeof(unit_t));
+	if (!tmp) return NULL;
+
+	tmp->stream = section_alloc(siz, NULL);
+	if (!tmp->stream) goto error;
+
+	tmp->cont = cont;
+
+	return tmp;
+
+error:
+	alloc_free(tmp);
+	return NULL;
+}
+
+int unit_define(unit_t *unit, const char *name, size_t off, size_t line)
+{
+	size_t pos = push_name(unit, name);
+	if (pos == UNIT_NONE) return -1;
+
+	section_forget(unit->stream);
+
+	if (unit->defs_cnt + 1 > unit->defs_siz) {
+		unit_def_t *tmp = alloc_grow(
+			unit->defs,
+			&unit->defs_siz,
+			unit->defs_cnt + 1,
+			sizeof(*unit->defs)
+		);
+		if (!tmp) return -1;
+
+		unit->defs = tmp;
+	}
+
+	unit_def_t *def = unit->defs + unit->defs_cnt++;
+	def->name = pos;
+	def->off  = off;
+	def->line = line;
+
+	return 0;
+}
+
+void unit_free(unit_t *unit)
+{
+	if (!unit) return;
+
+	section_free(unit->stream);
+	alloc_free(unit->names);
+	alloc_free(unit->defs);
+	alloc_free(unit->refs);
+
+	alloc_free(unit);
+}
+
+int unit_refer(unit_t *unit, const char *name, size_t off, size_t line)
+{
+	size_t pos = push_name(unit, name);
+	if (pos == UNIT_NONE) return -1;
+
+	if (unit->refs_cnt + 1 > unit->refs_siz) {
+		unit_ref_t *tmp = alloc_grow(
+			unit->refs,
+			&unit->refs_siz,
+			unit->refs_cnt + 1,
+			sizeof(*unit->refs)
+		);
+		if (!tmp) return -1;
+
+		unit->refs = tmp;
+	}
+
+	unit_ref_t *ref = unit->refs + unit->refs_cnt++;
+	ref->name = pos;
+	ref->off  = off;
+	ref->line = line;
+
+	return 0;
+}
+
+void unit_reset(unit_t *unit)
+{
+	section_forget(unit->stream);
+
+	unit->stream->cnt = 0;
+	unit->names_cnt   = 0;
+	unit->defs_cnt    = 0;
+	unit->refs_cnt    = 0;
+	unit->lead        = 0;
+	unit->line        = 0;
+	unit->err         = JAVK_AS_ERROR_NONE;
+}
+
+
+static size_t push_name(unit_t *unit, const char *name)
+{
+	size_t len = strlen(name) + 1;
+
+	if (unit->names_cnt + len > unit->names_siz) {
+		char *tmp = alloc_grow(
+			unit->names,
+			&unit->names_siz,
+			unit->names_cnt + len,
+			sizeof(*unit->names)
+		);
+		if (!tmp) return UNIT_NONE;
+
+		unit->names = tmp;
+	}
+
+	size_t pos = unit->names_cnt;
+
+	memcpy(unit->names + pos, name, len);
+	unit->names_cnt += len;
+
+	return pos;
+}
@@ -0,0 +1,76 @@
+/*
+ * unit.h -- encoded source fragments
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_UNIT
+#define JAVK_AS_ASM_UNIT
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "asm/section.h"
+
+
+#define UNIT_STREAMSIZ 4096
+#define UNIT_SECSIZ    256   // one run of sections, see javk_as_incremental()
+
+
+typedef struct unit_def_s {
+	size_t name;  // offset of the label name
+	size_t off;   // start of the section in the stream
+	size_t line;
+} unit_def_t;
+
+typedef struct unit_ref_s {
+	size_t name;  // offset of the label name
+	size_t off;   // start of the expansion to patch
+	size_t line;
+} unit_ref_t;
+
+// the bytes, label definitions and label references encoded from one
+// stretch of source
+typedef struct unit_s {
+	section_t *stream;
+
+	char  *names;  // label names, NUL terminated
+	size_t names_cnt;
+	size_t names_siz;
+
+	unit_def_t *defs;
+	size_t      defs_cnt;
+	size_t      defs_siz;
+
+	unit_ref_t *refs;
+	size_t      refs_cnt;
+	size_t      refs_siz;
+
+	bool   cont;   // may continue the section of a preceding unit
+	size_t lead;   // instructions before the first label
+	size_t line;   // line of the first leading instruction
+	int    err;    // why encoding failed, one of enum javk_as_error
+} unit_t;
+
+
+unit_t *unit_alloc(bool cont, size_t siz);
+int     unit_define(unit_t *unit, const char *name, size_t off, size_t line);
+void    unit_free(unit_t *unit);
+int     unit_refer(unit_t *unit, const char *name, size_t off, size_t line);
+void    unit_reset(unit_t *unit);
+
+
+#endif /* JAVK_AS_ASM_UNIT */
@@ -0,0 +1,34 @@
+/*
+ * unit_private.h -- encoded source fragments
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_ASM_UNIT_PRIVATE
+#define JAVK_AS_ASM_UNIT_PRIVATE
+
+
+#include "asm/unit.h"
+
+#include <stddef.h>
+
+
+#define UNIT_NONE ((size_t) -1)
+
+
+static size_t push_name(unit_t *unit, const char *name);
+
+
+#endif /* JAVK_AS_ASM_UNIT_PRIVATE */
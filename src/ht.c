@@ -22,90 +22,202 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "alloc.h"
+#include "arena.h"
+#include "stats.h"
 
-ht_t *ht_alloc(void)
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+ht_t *ht_alloc(arena_t *arena, ht_hash_t hash, unsigned flags)
 {
-	ht_t *tmp = malloc(sizeof(ht_t));
+	ht_t *tmp = alloc_calloc(1, sizeof(ht_t));
 	if (!tmp) return NULL;
 
-	tmp->ent = calloc(HT_DEFAULT_CAP, sizeof(ht_ent_t));
-	if (!tmp->ent) goto error;
+	if (tab_init(&tmp->tab, HT_DEFAULT_CAP) < 0) goto error;
 
-	tmp->cap = HT_DEFAULT_CAP;
-	tmp->cnt = 0;
+	tmp->hash  = (hash) ? hash : HT_DEFAULT_HASH;
+	tmp->seed  = (flags & HT_SEEDED) ? random_seed() : 0;
+	tmp->flags = flags;
+	tmp->arena = arena;
 
 	return tmp;
 
 error:
-	free(tmp);
+	alloc_free(tmp);
 	return NULL;
 }
 
+void ht_clear(ht_t *ht, void (*free_val)(void *ptr))
+{
+	release(ht, free_val);
+
+	// the table keeps its capacity for the next round of inserts
+	tab_free(&ht->old);
+	ht->mig = 0;
+
+	memset(ht->tab.ctrl, HT_EMPTY, ht->tab.cap + HT_GROUP);
+	ht->tab.maxdist = 0;
+	ht->cnt         = 0;
+}
+
+void *ht_del(ht_t *ht, const void *key, size_t len)
+{
+	if (!key || !len) return NULL;
+
+	// shifting entries back could carry them across the migration point
+	if (ht->old.cap) migrate(ht, ht->old.cap);
+
+	uint64_t  hash   = ht->hash(key, len, ht->seed);
+	size_t    probes = 0;
+	ht_ent_t *ent    = tab_get(&ht->tab, key, len, hash, &probes);
+
+	stats_thread.ht_probes += probes;
+	if (!ent) return NULL;
+
+	void *val = ent->val;
+
+	if (HT_OWNS_KEYS(ht)) alloc_free(ent->key);
+	tab_del(&ht->tab, ent);
+	--ht->cnt;
+
+	return val;
+}
+
 void ht_free(ht_t *ht, void (*free_val)(void *ptr))
 {
 	if (!ht) return;
 
-	ht_ent_t *ent = ht->ent;
-	if (free_val) {
-		while (ht->cap) {
-			if (ent->key) {
-				free(ent->key);
-				if (ent->val) free_val(ent->val);
-			}
-			--ht->cap;
-			++ent;
-		}
-	} else {
-		while (ht->cap) {
-			if (ent->key) free(ent->key);
-			--ht->cap;
-			++ent;
-		}
-	}
+	release(ht, free_val);
 
-	free(ht->ent);
-	free(ht);
+	tab_free(&ht->tab);
+	tab_free(&ht->old);
+	alloc_free(ht);
 }
 
 void *ht_get(const ht_t *ht, const void *key, size_t len)
 {
-	if (!key || !len) return NULL;
+	size_t probes = 0;
 
-	size_t i = (size_t) (fnv1a_hash(key, len) & (uint64_t) (ht->cap - 1));
+	return ht_probe(ht, key, len, &probes);
+}
 
-	while (ht->ent[i].key) {
-		if (len != ht->ent[i].key_len) {
-			++i;
-			if (i >= ht->cap) i = 0;
-			continue;
-		}
+void *ht_probe(const ht_t *ht, const void *key, size_t len, size_t *probes)
+{
+	if (!key || !len) return NULL;
 
-		if (!memcmp(key, ht->ent[i].key, len))
-			return ht->ent[i].val;
+	uint64_t  hash = ht->hash(key, len, ht->seed);
+	size_t    cnt  = 0;
+	ht_ent_t *ent  = tab_get(&ht->tab, key, len, hash, &cnt);
 
-		++i;
-		if (i >= ht->cap) i = 0;
-	}
+	// anything not found in tab has yet to be migrated
+	if (!ent && ht->old.cap) ent = tab_get(&ht->old, key, len, hash, &cnt);
 
-	return NULL;
+	stats_thread.ht_probes += cnt;
+	*probes += cnt;
+
+	return (ent) ? ent->val : NULL;
 }
 
 int ht_set(ht_t *ht, const void *key, size_t len, void *val)
 {
-	if (ht->cnt >= (ht->cap / 2) && rehash(ht)) return -1;
+	if (!key || !len) return -1;
+
+	if (ht->old.cap) migrate(ht, HT_MIGRATE);
+
+	uint64_t  hash   = ht->hash(key, len, ht->seed);
+	size_t    probes = 0;
+	ht_ent_t *ent    = tab_get(&ht->tab, key, len, hash, &probes);
+
+	if (!ent && ht->old.cap) ent = tab_get(&ht->old, key, len, hash, &probes);
 
-	if (ht_set_private(ht, (void*) key, len, val, true)) return -1;
+	stats_thread.ht_probes += probes;
+
+	if (ent) {
+		ent->val = val;
+		return 0;
+	}
+
+	if (ht->cnt >= ht->tab.cap / HT_MAXLOAD_DEN * HT_MAXLOAD_NUM
+		&& rehash(ht)
+	)
+		return -1;
+
+	void *tmp = (void*) key;
+
+	if (!(ht->flags & HT_NOCOPY)) {
+		tmp = (ht->arena) ? arena_malloc(ht->arena, len) : alloc_malloc(len);
+		if (!tmp) return -1;
+
+		memcpy(tmp, key, len);
+	}
+
+	tab_put(&ht->tab, tmp, len, val, hash);
+	++ht->cnt;
 
 	return 0;
 }
 
+void ht_stats(const ht_t *ht, ht_stats_t *stats)
+{
+	const ht_tab_t *tab  = &ht->tab;
+	size_t          mask = tab->cap - 1;
+
+	memset(stats, 0, sizeof(*stats));
+
+	stats->cnt = ht->cnt;
+	stats->cap = tab->cap;
+
+	if (!tab->cap) return;
+
+	// the load limit keeps a slot empty, start after it so no cluster
+	// wraps around the end of the table
+	size_t first = 0;
+	while (tab->ctrl[first] != HT_EMPTY) first++;
+
+	size_t entries = 0;
+	size_t total   = 0;
+	size_t run     = 0;
+
+	for (size_t n = 1; n <= tab->cap; n++) {
+		size_t i = (first + n) & mask;
+
+		if (tab->ctrl[i] != HT_EMPTY) {
+			size_t dist = HT_DIST(tab, i, tab->ent[i].hash);
+
+			++stats->probe_hist[(dist < HT_STATS_HIST) ? dist : HT_STATS_HIST - 1];
+			if (dist > stats->probe_max) stats->probe_max = dist;
+
+			total += dist;
+			++entries;
+			++run;
+			continue;
+		}
+
+		if (!run) continue;
+
+		++stats->cluster_hist[hist_bucket(run)];
+		if (run > stats->cluster_max) stats->cluster_max = run;
 
-static uint64_t fnv1a_hash(const void *key, size_t len)
+		++stats->clusters;
+		run = 0;
+	}
+
+	stats->pending    = ht->cnt - entries;
+	stats->load       = (double) entries / tab->cap;
+	stats->probe_mean = (entries) ? (double) total / entries : 0.0;
+}
+
+uint64_t ht_hash_fnv1a(const void *key, size_t len, uint64_t seed)
 {
-	uint64_t hash = FNV_OFFSET_BASIS;
+	uint64_t hash = FNV_OFFSET_BASIS ^ seed;
 
 	const unsigned char *byte = key;
 	for (size_t i = 0; i < len; i++, byte++) {
@@ -116,78 +228,358 @@ static uint64_t fnv1a_hash(const void *key, size_t len)
 	return hash;
 }
 
-static int ht_set_private(ht_t *ht, void *key, size_t len, void *val, bool cpy)
+// wyhash: word-at-a-time, one wide multiply per 16 bytes
+uint64_t ht_hash_wy(const void *key, size_t len, uint64_t seed)
 {
-	if (!key || !len) return -1;
+	const unsigned char *p = key;
+	uint64_t             a;
+	uint64_t             b;
+
+	seed ^= wy_mix(seed ^ WY_P0, WY_P1);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			size_t off = (len >> 3) << 2;
+
+			a = (wy_r4(p) << 32) | wy_r4(p + off);
+			b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - off);
+		} else if (len) {
+			a = wy_r3(p, len);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
 
-	size_t i = (size_t) (fnv1a_hash(key, len) & (uint64_t) (ht->cap - 1));
+		if (i > 48) {
+			uint64_t see1 = seed;
+			uint64_t see2 = seed;
 
-	while (ht->ent[i].key) {
-		if (len != ht->ent[i].key_len) {
-			++i;
-			if (i >= ht->cap) i = 0;
-			continue;
+			do {
+				seed = wy_mix(wy_r8(p) ^ WY_P1, wy_r8(p + 8) ^ seed);
+				see1 = wy_mix(wy_r8(p + 16) ^ WY_P2, wy_r8(p + 24) ^ see1);
+				see2 = wy_mix(wy_r8(p + 32) ^ WY_P3, wy_r8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+
+			seed ^= see1 ^ see2;
 		}
 
-		if (!memcmp(key, ht->ent[i].key, len)) {
-			ht->ent[i].val = val;
-			return 0;
+		while (i > 16) {
+			seed = wy_mix(wy_r8(p) ^ WY_P1, wy_r8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
 		}
 
-		++i;
-		if (i >= ht->cap) i = 0;
+		a = wy_r8(p + i - 16);
+		b = wy_r8(p + i - 8);
 	}
 
-	if (cpy) {
-		void *tmp = malloc(len);
-		if (!tmp) return -1;
+	a ^= WY_P1;
+	b ^= seed;
+	wy_mum(&a, &b);
 
-		memcpy(tmp, key, len);
-		key = tmp;
+	return wy_mix(a ^ WY_P0 ^ len, b ^ WY_P1);
+}
+
+
+static inline unsigned group_empty(const uint8_t *ctrl)
+{
+#ifdef __SSE2__
+	// HT_EMPTY is the only control byte with its top bit set
+	return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+#else
+	unsigned mask = 0;
+	for (unsigned i = 0; i < HT_GROUP; i++)
+		mask |= (unsigned) (ctrl[i] == HT_EMPTY) << i;
+
+	return mask;
+#endif
+}
+
+static inline unsigned group_match(const uint8_t *ctrl, uint8_t h2)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+#else
+	unsigned mask = 0;
+	for (unsigned i = 0; i < HT_GROUP; i++)
+		mask |= (unsigned) (ctrl[i] == h2) << i;
+
+	return mask;
+#endif
+}
+
+static unsigned hist_bucket(size_t n)
+{
+	unsigned bucket = 0;
+
+	while (n >>= 1) bucket++;
+
+	return (bucket < HT_STATS_HIST) ? bucket : HT_STATS_HIST - 1;
+}
+
+static void migrate(ht_t *ht, size_t cnt)
+{
+	ht_tab_t *old = &ht->old;
+
+	// migrated slots stay in old, lookups hit them in tab first
+	for (; cnt && ht->mig < old->cap; cnt--, ht->mig++) {
+		if (old->ctrl[ht->mig] == HT_EMPTY) continue;
+
+		ht_ent_t *ent = old->ent + ht->mig;
+		tab_put(&ht->tab, ent->key, ent->key_len, ent->val, ent->hash);
 	}
 
-	ht->ent[i].key     = key;
-	ht->ent[i].key_len = len;
-	ht->ent[i].val     = val;
-	++ht->cnt;
+	if (ht->mig < old->cap) return;
 
-	return 0;
+	tab_free(old);
+	ht->mig = 0;
+}
+
+static uint64_t random_seed(void)
+{
+	uint64_t seed = 0;
+
+	FILE *stream = fopen("/dev/urandom", "rb");
+	if (stream) {
+		if (fread(&seed, sizeof(seed), 1, stream) != 1) seed = 0;
+		fclose(stream);
+	}
+
+	// fall back on whatever varies between runs
+	if (!seed) {
+		seed = (uint64_t) time(NULL) ^ (uint64_t) clock();
+		seed = ht_hash_wy(&seed, sizeof(seed), (uintptr_t) &seed);
+	}
+
+	return seed;
 }
 
 static int rehash(ht_t *ht)
 {
-	ht_ent_t *oldent = ht->ent;
-	size_t    oldcap = ht->cap;
+	// tab can't fill up before a pending migration completes, but be sure
+	if (ht->old.cap) migrate(ht, ht->old.cap);
+
+	ht_tab_t old = ht->tab;
+
+	if (old.cap * 2 < old.cap) return -1;
+	if (tab_init(&ht->tab, old.cap * 2) < 0) {
+		ht->tab = old;
+		return -1;
+	}
+
+	ht->old = old;
+	ht->mig = 0;
+
+	++stats_thread.ht_rehashes;
+
+	if (!(ht->flags & HT_INCREMENTAL)) migrate(ht, old.cap);
+
+	return 0;
+}
+
+static void release(ht_t *ht, void (*free_val)(void *ptr))
+{
+	if (!free_val && !HT_OWNS_KEYS(ht)) return;
+
+	ht_tab_t *tab = &ht->tab;
+	for (size_t i = 0; i < tab->cap; i++) {
+		if (tab->ctrl[i] == HT_EMPTY) continue;
+
+		if (HT_OWNS_KEYS(ht)) alloc_free(tab->ent[i].key);
+		if (free_val && tab->ent[i].val) free_val(tab->ent[i].val);
+	}
+
+	// migrated entries are owned by tab
+	tab = &ht->old;
+	for (size_t i = ht->mig; i < tab->cap; i++) {
+		if (tab->ctrl[i] == HT_EMPTY) continue;
+
+		if (HT_OWNS_KEYS(ht)) alloc_free(tab->ent[i].key);
+		if (free_val && tab->ent[i].val) free_val(tab->ent[i].val);
+	}
+}
+
+static inline void set_ctrl(ht_tab_t *tab, size_t i, uint8_t ctrl)
+{
+	tab->ctrl[i] = ctrl;
+
+	// mirror the head so group loads never wrap
+	if (i < HT_GROUP) tab->ctrl[tab->cap + i] = ctrl;
+}
+
+static void tab_del(ht_tab_t *tab, ht_ent_t *ent)
+{
+	size_t mask = tab->cap - 1;
+	size_t i    = ent - tab->ent;
+
+	// backward shift: pull the rest of the cluster one slot closer to home
+	for (;;) {
+		size_t next = (i + 1) & mask;
+
+		if (tab->ctrl[next] == HT_EMPTY) break;
+		if (!HT_DIST(tab, next, tab->ent[next].hash)) break;
+
+		set_ctrl(tab, i, tab->ctrl[next]);
+		tab->ent[i] = tab->ent[next];
+
+		i = next;
+	}
+
+	set_ctrl(tab, i, HT_EMPTY);
+}
+
+static void tab_free(ht_tab_t *tab)
+{
+	alloc_free(tab->ctrl);
+	alloc_free(tab->ent);
+
+	tab->ctrl = NULL;
+	tab->ent  = NULL;
+	tab->cap  = 0;
+}
+
+static ht_ent_t *tab_get(const ht_tab_t *tab, const void *key, size_t len, uint64_t hash, size_t *probes)
+{
+	size_t  mask = tab->cap - 1;
+	uint8_t h2   = HT_H2(hash);
 
-	ht->cap *= 2;
-	if (oldcap > ht->cap) goto error;
+	++stats_thread.ht_lookups;
 
-	ht->ent = calloc(ht->cap, sizeof(ht_ent_t));
-	if (!ht->ent) goto error;
+	// no entry sits further than maxdist from home
+	for (size_t off = 0; off <= tab->maxdist; off += HT_GROUP) {
+		size_t   i     = (hash + off) & mask;
+		unsigned match = group_match(tab->ctrl + i, h2);
 
-	ht->cnt = 0;
+		++*probes;
 
-	ht_ent_t *ent = oldent;
-	for (size_t i = 0; i < oldcap; i++) {
-		if (ent->key)
-			ht_set_private(
-				ht,
-				ent->key,
-				ent->key_len,
-				ent->val,
-				false
-			);
+		while (match) {
+			ht_ent_t *ent = tab->ent + ((i + __builtin_ctz(match)) & mask);
+
+			if (hash == ent->hash
+				&& len == ent->key_len
+				&& !memcmp(key, ent->key, len)
+			)
+				return ent;
+
+			match &= match - 1;
+		}
+
+		if (group_empty(tab->ctrl + i)) return NULL;
+	}
+
+	return NULL;
+}
 
-		++ent;
+static int tab_init(ht_tab_t *tab, size_t cap)
+{
+	tab->ctrl = alloc_malloc(cap + HT_GROUP);
+	if (!tab->ctrl) return -1;
+	memset(tab->ctrl, HT_EMPTY, cap + HT_GROUP);
+
+	tab->ent = alloc_malloc(cap * sizeof(ht_ent_t));
+	if (!tab->ent) {
+		alloc_free(tab->ctrl);
+		return -1;
 	}
 
-	free(oldent);
+	tab->cap     = cap;
+	tab->maxdist = 0;
 
 	return 0;
+}
 
-error:
-	ht->ent = oldent;
-	ht->cap = oldcap;
+static void tab_put(ht_tab_t *tab, void *key, size_t len, void *val, uint64_t hash)
+{
+	size_t   mask = tab->cap - 1;
+	size_t   i    = hash & mask;
+	size_t   dist = 0;
+	ht_ent_t ent  = {
+		.key     = key,
+		.key_len = len,
+		.val     = val,
+		.hash    = hash,
+	};
+
+	// robin hood: take the slot of anyone closer to their home than us
+	while (tab->ctrl[i] != HT_EMPTY) {
+		size_t tmpdist = HT_DIST(tab, i, tab->ent[i].hash);
+
+		if (tmpdist < dist) {
+			ht_ent_t tmp = tab->ent[i];
+
+			tab->ent[i] = ent;
+			set_ctrl(tab, i, HT_H2(ent.hash));
+			if (dist > tab->maxdist) tab->maxdist = dist;
+
+			ent  = tmp;
+			dist = tmpdist;
+		}
+
+		i = (i + 1) & mask;
+		++dist;
+	}
+
+	tab->ent[i] = ent;
+	set_ctrl(tab, i, HT_H2(ent.hash));
+	if (dist > tab->maxdist) tab->maxdist = dist;
+}
+
+
+static inline void wy_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ typedef unsigned __int128 u128;
+
+	u128 r = (u128) *a * *b;
+
+	*a = (uint64_t) r;
+	*b = (uint64_t) (r >> 64);
+#else
+	uint64_t ha = *a >> 32, la = (uint32_t) *a;
+	uint64_t hb = *b >> 32, lb = (uint32_t) *b;
+
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t  = rl + (rm0 << 32);
+	uint64_t c  = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+
+	c += lo < t;
+
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+	wy_mum(&a, &b);
+
+	return a ^ b;
+}
 
-	return -1;
+static inline uint64_t wy_r3(const unsigned char *p, size_t len)
+{
+	return ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+}
+
+static inline uint64_t wy_r4(const unsigned char *p)
+{
+	uint32_t tmp;
+	memcpy(&tmp, p, sizeof(tmp));
+
+	return tmp;
+}
+
+static inline uint64_t wy_r8(const unsigned char *p)
+{
+	uint64_t tmp;
+	memcpy(&tmp, p, sizeof(tmp));
+
+	return tmp;
 }
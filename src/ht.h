@@ -21,28 +21,87 @@
 
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
 
 
 #define HT_DEFAULT_CAP 512
+#define HT_GROUP       16
+#define HT_MIGRATE     64  // slots moved per ht_set() while resizing
+#define HT_MAXLOAD_NUM 7   // grow past 7/8 full
+#define HT_MAXLOAD_DEN 8
+#define HT_STATS_HIST  16  // histogram buckets, see ht_stats_t
+
+#define HT_DEFAULT_HASH ht_hash_wy
+
+// flags
+#define HT_INCREMENTAL (1 << 0)  // spread resizes over later inserts
+#define HT_SEEDED      (1 << 1)  // pick a random per-table seed
+#define HT_NOCOPY      (1 << 2)  // reference keys instead of copying them
+
+
+typedef uint64_t (*ht_hash_t)(const void *key, size_t len, uint64_t seed);
 
 
 typedef struct ht_ent_s {
-	void   *key;
-	size_t  key_len;
-	void   *val;
+	void     *key;
+	size_t    key_len;
+	void     *val;
+	uint64_t  hash;
 } ht_ent_t;
 
-typedef struct ht_s {
+typedef struct ht_tab_s {
+	uint8_t  *ctrl;     // hash fragments, cap + HT_GROUP bytes
 	ht_ent_t *ent;
 	size_t    cap;
-	size_t    cnt;
+	size_t    maxdist;  // furthest any entry sits from its home slot
+} ht_tab_t;
+
+// a snapshot of how entries sit in the current table
+typedef struct ht_stats_s {
+	size_t cnt;
+	size_t cap;
+	size_t pending;  // entries still waiting in the table being resized away
+	double load;
+
+	// probe length is how far past its home slot an entry sits, the
+	// last bucket also holds anything further out
+	double probe_mean;
+	size_t probe_max;
+	size_t probe_hist[HT_STATS_HIST];
+
+	// clusters are runs of occupied slots, bucket i holds the ones of
+	// 2^i up to 2^(i + 1) - 1 slots
+	size_t clusters;
+	size_t cluster_max;
+	size_t cluster_hist[HT_STATS_HIST];
+} ht_stats_t;
+
+typedef struct ht_s {
+	ht_tab_t   tab;
+	ht_tab_t   old;    // being migrated into tab
+	size_t     mig;    // next slot of old to migrate
+	size_t     cnt;
+	ht_hash_t  hash;
+	uint64_t   seed;
+	unsigned   flags;
+	arena_t   *arena;  // backs key copies when set
 } ht_t;
 
 
-ht_t *ht_alloc(void);
-void  ht_free(ht_t *ht, void (*free_val)(void *ptr));
-void *ht_get(const ht_t *ht, const void *key, size_t len);
-int   ht_set(ht_t *ht, const void *key, size_t len, void *val);
+ht_t     *ht_alloc(arena_t *arena, ht_hash_t hash, unsigned flags);
+void      ht_clear(ht_t *ht, void (*free_val)(void *ptr));
+void     *ht_del(ht_t *ht, const void *key, size_t len);
+void      ht_free(ht_t *ht, void (*free_val)(void *ptr));
+void     *ht_get(const ht_t *ht, const void *key, size_t len);
+// ht_get() that also adds the control groups it scanned to *probes
+void     *ht_probe(const ht_t *ht, const void *key, size_t len, size_t *probes);
+int       ht_set(ht_t *ht, const void *key, size_t len, void *val);
+void      ht_stats(const ht_t *ht, ht_stats_t *stats);
+
+uint64_t  ht_hash_fnv1a(const void *key, size_t len, uint64_t seed);
+uint64_t  ht_hash_wy(const void *key, size_t len, uint64_t seed);
 
 
 #endif /* JAVK_AS_HT */
@@ -30,10 +30,39 @@
 #define FNV_OFFSET_BASIS 0xcbf29ce484222325UL
 #define FNV_PRIME        0x100000001b3UL
 
+#define WY_P0 0xa0761d6478bd642fUL
+#define WY_P1 0xe7037ed1a0b428dbUL
+#define WY_P2 0x8ebc6af09c88c6e3UL
+#define WY_P3 0x589965cc75374cc3UL
 
-static uint64_t fnv1a_hash(const void *key, size_t len);
-static int      ht_set_private(ht_t *ht, void *key, size_t len, void *val, bool cpy);
-static int      rehash(ht_t *ht);
+// control bytes hold the top 7 bits of a hash, or HT_EMPTY
+#define HT_EMPTY 0x80
+#define HT_H2(hash) ((uint8_t) ((hash) >> 57))
+
+// keys copied onto the heap have to be freed one by one
+#define HT_OWNS_KEYS(ht) (!(ht)->arena && !((ht)->flags & HT_NOCOPY))
+
+#define HT_DIST(tab, i, hash) (((i) - (hash)) & ((tab)->cap - 1))
+
+
+static inline unsigned group_empty(const uint8_t *ctrl);
+static inline unsigned group_match(const uint8_t *ctrl, uint8_t h2);
+static unsigned        hist_bucket(size_t n);
+static void            migrate(ht_t *ht, size_t cnt);
+static uint64_t        random_seed(void);
+static int             rehash(ht_t *ht);
+static void            release(ht_t *ht, void (*free_val)(void *ptr));
+static inline void     set_ctrl(ht_tab_t *tab, size_t i, uint8_t ctrl);
+static void            tab_del(ht_tab_t *tab, ht_ent_t *ent);
+static void            tab_free(ht_tab_t *tab);
+static ht_ent_t       *tab_get(const ht_tab_t *tab, const void *key, size_t len, uint64_t hash, size_t *probes);
+static int             tab_init(ht_tab_t *tab, size_t cap);
+static void            tab_put(ht_tab_t *tab, void *key, size_t len, void *val, uint64_t hash);
+static inline void     wy_mum(uint64_t *a, uint64_t *b);
+static inline uint64_t wy_mix(uint64_t a, uint64_t b);
+static inline uint64_t wy_r3(const unsigned char *p, size_t len);
+static inline uint64_t wy_r4(const unsigned char *p);
+static inline uint64_t wy_r8(const unsigned char *p);
 
 
 #endif /* JAVK_AS_HT_PRIVATE */
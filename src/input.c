@@ -0,0 +1,142 @@
+/*
+ * input.c -- source input
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "input.h"
+#include "input_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+void input_close(input_t *in)
+{
+	if (!in) return;
+
+	if (in->mapped) munmap((void*) in->buf, in->siz);
+	else free((void*) in->buf);
+
+	free(in);
+}
+
+input_t *input_open(const char *path)
+{
+	int fd = STDIN_FILENO;
+	int err;
+
+	if (strcmp(path, "-")) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) return NULL;
+	}
+
+	input_t *tmp = calloc(1, sizeof(input_t));
+	if (!tmp) goto error;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) goto error;
+
+	// pipes, ttys and anything else we can't map get read in chunks
+	if (S_ISREG(st.st_mode)
+		&& st.st_size > 0
+		&& (uintmax_t) st.st_size <= SIZE_MAX
+		&& !input_map(tmp, fd, st.st_size)
+	)
+		goto done;
+
+	if (input_read(tmp, fd) < 0) goto error;
+
+done:
+	if (fd != STDIN_FILENO) close(fd);
+
+	return tmp;
+
+error:
+	err = errno;
+
+	if (fd != STDIN_FILENO) close(fd);
+	free(tmp);
+
+	errno = err;
+	return NULL;
+}
+
+
+static int input_map(input_t *in, int fd, size_t len)
+{
+	void *tmp = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (tmp == MAP_FAILED) return -1;
+
+	// the lexer makes a single forward pass
+	posix_madvise(tmp, len, POSIX_MADV_SEQUENTIAL);
+
+	in->buf    = tmp;
+	in->len    = len;
+	in->siz    = len;
+	in->mapped = true;
+
+	return 0;
+}
+
+static int input_read(input_t *in, int fd)
+{
+	char   *buf = NULL;
+	size_t  len = 0;
+	size_t  siz = 0;
+	ssize_t ret;
+
+	do {
+		if (len == siz) {
+			size_t newsiz = (siz) ? siz * 2 : INPUT_CHUNKSIZ;
+			if (newsiz < siz) goto error;
+
+			char *tmp = realloc(buf, newsiz);
+			if (!tmp) goto error;
+
+			buf = tmp;
+			siz = newsiz;
+		}
+
+		ret = read(fd, buf + len, siz - len);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			goto error;
+		}
+
+		len += ret;
+	} while (ret);
+
+	in->buf    = buf;
+	in->len    = len;
+	in->siz    = siz;
+	in->mapped = false;
+
+	return 0;
+
+error:
+	free(buf);
+	return -1;
+}
@@ -0,0 +1,42 @@
+/*
+ * input.h -- source input
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_INPUT
+#define JAVK_AS_INPUT
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#define INPUT_CHUNKSIZ (64 * 1024)
+
+
+typedef struct input_s {
+	const char *buf;
+	size_t      len;
+	size_t      siz;
+	bool        mapped;
+} input_t;
+
+
+void     input_close(input_t *in);
+input_t *input_open(const char *path);
+
+
+#endif /* JAVK_AS_INPUT */
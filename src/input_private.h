@@ -0,0 +1,32 @@
+/*
+ * input_private.h -- source input
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_INPUT_PRIVATE
+#define JAVK_AS_INPUT_PRIVATE
+
+
+#include "input.h"
+
+#include <stddef.h>
+
+
+static int input_map(input_t *in, int fd, size_t len);
+static int input_read(input_t *in, int fd);
+
+
+#endif /* JAVK_AS_INPUT_PRIVATE */
@@ -0,0 +1,178 @@
+/*
+ * intern.c -- string interning
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "intern.h"
+#include "intern_private.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "ht.h"
+
+
+intern_t *intern_alloc(void)
+{
+	intern_t *tmp = alloc_calloc(1, sizeof(intern_t));
+	if (!tmp) return NULL;
+
+	tmp->slot = alloc_malloc(INTERN_DEFAULT_CAP * sizeof(uint32_t));
+	if (!tmp->slot) goto error;
+	memset(tmp->slot, 0xff, INTERN_DEFAULT_CAP * sizeof(uint32_t));
+
+	tmp->off = alloc_malloc(sizeof(uint32_t));
+	if (!tmp->off) goto error;
+	tmp->off[0] = 0;
+
+	tmp->cap = INTERN_DEFAULT_CAP;
+
+	return tmp;
+
+error:
+	alloc_free(tmp->slot);
+	alloc_free(tmp);
+	return NULL;
+}
+
+void intern_clear(intern_t *in)
+{
+	// buffers keep their capacity for the next round of strings
+	memset(in->slot, 0xff, in->cap * sizeof(uint32_t));
+
+	in->str_cnt = 0;
+	in->off[0]  = 0;
+	in->cnt     = 0;
+}
+
+void intern_free(intern_t *in)
+{
+	if (!in) return;
+
+	alloc_free(in->str);
+	alloc_free(in->off);
+	alloc_free(in->hash);
+	alloc_free(in->slot);
+	alloc_free(in);
+}
+
+uint32_t intern_get(intern_t *in, const char *key, size_t len)
+{
+	uint32_t  h    = hash(key, len);
+	uint32_t *slot = slot_get(in, key, len, h);
+
+	if (*slot != INTERN_NONE) return *slot;
+
+	if (in->cnt >= in->cap / 2) {
+		if (regrow(in) < 0) return INTERN_NONE;
+		slot = slot_get(in, key, len, h);
+	}
+
+	if (in->cnt + 1 >= INTERN_NONE) return INTERN_NONE;
+	if (in->str_cnt + len + 1 > UINT32_MAX) return INTERN_NONE;
+
+	if (in->cnt + 1 >= in->siz) {
+		size_t siz = (in->siz) ? in->siz * 2 : INTERN_DEFAULT_CAP;
+
+		uint32_t *off = alloc_realloc(in->off, (siz + 1) * sizeof(uint32_t));
+		if (!off) return INTERN_NONE;
+		in->off = off;
+
+		uint32_t *tmp = alloc_realloc(in->hash, siz * sizeof(uint32_t));
+		if (!tmp) return INTERN_NONE;
+		in->hash = tmp;
+
+		in->siz = siz;
+	}
+
+	if (in->str_cnt + len + 1 > in->str_siz) {
+		size_t siz = (in->str_siz) ? in->str_siz : INTERN_DEFAULT_CAP;
+		while (siz < in->str_cnt + len + 1) siz *= 2;
+
+		char *tmp = alloc_realloc(in->str, siz);
+		if (!tmp) return INTERN_NONE;
+
+		in->str     = tmp;
+		in->str_siz = siz;
+	}
+
+	uint32_t id = in->cnt++;
+
+	memcpy(in->str + in->str_cnt, key, len);
+	in->str_cnt += len;
+	in->str[in->str_cnt++] = '\0';
+
+	in->off[in->cnt] = in->str_cnt;
+	in->hash[id]     = h;
+	*slot            = id;
+
+	return id;
+}
+
+size_t intern_len(const intern_t *in, uint32_t id)
+{
+	return in->off[id + 1] - in->off[id] - 1;
+}
+
+
+static inline uint32_t hash(const char *key, size_t len)
+{
+	return (uint32_t) ht_hash_wy(key, len, 0);
+}
+
+static int regrow(intern_t *in)
+{
+	size_t cap = in->cap * 2;
+	if (cap < in->cap) return -1;
+
+	uint32_t *slot = alloc_malloc(cap * sizeof(uint32_t));
+	if (!slot) return -1;
+	memset(slot, 0xff, cap * sizeof(uint32_t));
+
+	// ids are unique and the hashes are kept, no key bytes are read
+	for (uint32_t id = 0; id < in->cnt; id++) {
+		size_t i = in->hash[id] & (cap - 1);
+		while (slot[i] != INTERN_NONE) i = (i + 1) & (cap - 1);
+
+		slot[i] = id;
+	}
+
+	alloc_free(in->slot);
+	in->slot = slot;
+	in->cap  = cap;
+
+	return 0;
+}
+
+static uint32_t *slot_get(const intern_t *in, const char *key, size_t len, uint32_t h)
+{
+	size_t mask = in->cap - 1;
+
+	for (size_t i = h & mask;; i = (i + 1) & mask) {
+		uint32_t id = in->slot[i];
+
+		if (id == INTERN_NONE) return in->slot + i;
+
+		if (in->hash[id] == h
+			&& intern_len(in, id) == len
+			&& !memcmp(in->str + in->off[id], key, len)
+		)
+			return in->slot + i;
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ * intern.h -- string interning
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_INTERN
+#define JAVK_AS_INTERN
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define INTERN_DEFAULT_CAP 1024
+#define INTERN_NONE        UINT32_MAX
+
+
+// every distinct string is stored once, NUL-terminated, in str
+typedef struct intern_s {
+	char     *str;
+	size_t    str_cnt;
+	size_t    str_siz;
+
+	uint32_t *off;   // id -> offset into str, off[cnt] == str_cnt
+	uint32_t *hash;  // id -> hash
+	size_t    cnt;
+	size_t    siz;
+
+	uint32_t *slot;  // open addressed ids, INTERN_NONE when empty
+	size_t    cap;
+} intern_t;
+
+
+intern_t *intern_alloc(void);
+void      intern_clear(intern_t *in);
+void      intern_free(intern_t *in);
+uint32_t  intern_get(intern_t *in, const char *key, size_t len);
+size_t    intern_len(const intern_t *in, uint32_t id);
+
+
+#endif /* JAVK_AS_INTERN */
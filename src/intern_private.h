@@ -0,0 +1,34 @@
+/*
+ * intern_private.h -- string interning
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_INTERN_PRIVATE
+#define JAVK_AS_INTERN_PRIVATE
+
+
+#include "intern.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+static inline uint32_t hash(const char *key, size_t len);
+static int             regrow(intern_t *in);
+static uint32_t       *slot_get(const intern_t *in, const char *key, size_t len, uint32_t h);
+
+
+#endif /* JAVK_AS_INTERN_PRIVATE */
@@ -0,0 +1,114 @@
+/*
+ * javk-as.h -- embeddable assembler
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS
+#define JAVK_AS
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+#if defined(__GNUC__)
+#define JAVK_AS_API __attribute__((visibility("default")))
+#else
+#define JAVK_AS_API
+#endif
+
+
+// an assembler context, reusable across any number of assemblies but not
+// shared between threads; distinct contexts are independent
+typedef struct javk_as_s javk_as_t;
+
+enum javk_as_phase {
+	JAVK_AS_PHASE_SCAN,   // finding where the source splits
+	JAVK_AS_PHASE_PARSE,  // lexing and encoding, on every job
+	JAVK_AS_PHASE_LINK,   // resolving labels in source order
+	JAVK_AS_PHASE_CNT,
+};
+
+// why the last assembly failed, see javk_as_strerror()
+enum javk_as_error {
+	JAVK_AS_ERROR_NONE,
+	JAVK_AS_ERROR_NOMEM,      // out of memory
+	JAVK_AS_ERROR_SIZE,       // the binary did not fit the output
+	JAVK_AS_ERROR_SYNTAX,     // a line that is neither label nor statement
+	JAVK_AS_ERROR_MNEMONIC,   // an unknown instruction
+	JAVK_AS_ERROR_OPERANDS,   // the wrong number of operands
+	JAVK_AS_ERROR_REGISTER,   // a register the instruction can't take
+	JAVK_AS_ERROR_NUMBER,     // an operand that should be a number
+	JAVK_AS_ERROR_RANGE,      // an immediate or shift out of range
+	JAVK_AS_ERROR_LEAD,       // instructions before the first label
+	JAVK_AS_ERROR_UNDEFINED,  // a jump to a label never defined
+	JAVK_AS_ERROR_REDEFINED,  // a label defined twice
+	JAVK_AS_ERROR_RESERVED,   // a label named like a register
+	JAVK_AS_ERROR_ADDRESS,    // a jump target past 16 bits
+	JAVK_AS_ERROR_CNT,
+};
+
+// what the last assembly spent its time on
+typedef struct javk_as_stats_s {
+	double   wall[JAVK_AS_PHASE_CNT];  // seconds
+	double   cpu[JAVK_AS_PHASE_CNT];   // seconds across every thread
+	size_t   sections;
+	size_t   instructions;
+	uint64_t section_reallocs;
+	uint64_t ht_rehashes;
+	uint64_t ht_lookups;
+	uint64_t ht_probes;                // control groups scanned by lookups
+} javk_as_stats_t;
+
+
+JAVK_AS_API javk_as_t  *javk_as_alloc(void);
+// returns -1 on error, javk_as_error() then says why and javk_as_line()
+// points at the offending source
+JAVK_AS_API int         javk_as_assemble(javk_as_t *as, const char *src, size_t len);
+// *outlen holds the size of out on entry and the binary size on return,
+// a binary that does not fit fails with JAVK_AS_ERROR_SIZE
+JAVK_AS_API int         javk_as_assemble_to(javk_as_t *as, const char *src, size_t len, uint8_t *out, size_t *outlen);
+// keep encoded runs in dir across processes as well, implies
+// javk_as_incremental(), NULL stops using the directory
+JAVK_AS_API int         javk_as_cache_dir(javk_as_t *as, const char *dir);
+JAVK_AS_API size_t      javk_as_copy(const javk_as_t *as, uint8_t *out, size_t siz);
+// one of enum javk_as_error
+JAVK_AS_API int         javk_as_error(const javk_as_t *as);
+JAVK_AS_API void        javk_as_free(javk_as_t *as);
+// cut the source at labels into runs of a few kilobytes, see README.md, and
+// keep each run's encoding keyed on its text so the next assembly re-encodes
+// only runs that changed; turning it off discards the last result, returns
+// -1 on error
+JAVK_AS_API int         javk_as_incremental(javk_as_t *as, bool on);
+JAVK_AS_API void        javk_as_jobs(javk_as_t *as, unsigned jobs);
+// pick the input classifier of this context by name, see README.md; returns
+// the name in use, or NULL if unsupported here, a NULL name only asks
+JAVK_AS_API const char *javk_as_lexer(javk_as_t *as, const char *name);
+JAVK_AS_API size_t      javk_as_line(const javk_as_t *as);
+// print heap use by subsystem and call site for the whole process, returns
+// -1 unless the library was built with -Dalloc_tracking=true
+JAVK_AS_API int         javk_as_memory_report(FILE *stream);
+// drop instructions whose effect is never seen, see README.md
+JAVK_AS_API void        javk_as_optimize(javk_as_t *as, bool on);
+JAVK_AS_API size_t      javk_as_size(const javk_as_t *as);
+JAVK_AS_API void        javk_as_stats(const javk_as_t *as, javk_as_stats_t *stats);
+JAVK_AS_API const char *javk_as_strerror(int err);
+JAVK_AS_API int         javk_as_write(const javk_as_t *as, int fd);
+
+
+#endif /* JAVK_AS */
@@ -16,25 +16,285 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "javk-as.h"
+
+
+#define JOBS_MAX 1024
 
-#include "asm/parser.h"
+
+typedef struct stamp_s {
+	double wall;
+	double cpu;   // across every thread
+} stamp_t;
+
+
+static input_t   *in;
+static javk_as_t *as;
 
 
 static void cleanexit(void)
 {
-	parser_rm();
+	input_close(in);
+	javk_as_free(as);
+}
+
+static void usage(FILE *stream)
+{
+	fputs(
+		"usage: javk-as [-Ot] [-j jobs] [-o output] [--cache-dir dir] [--stats] [input]\n"
+		"\n"
+		"  -O, --optimize         drop instructions whose effect is never seen\n"
+		"  -j, --jobs N           encode on N threads, 0 for every core (default: 1)\n"
+		"  -o, --output FILE      write the binary to FILE (default: a.out)\n"
+		"      --cache-dir DIR    reuse sections encoded by earlier runs from DIR\n"
+		"      --lexer NAME       force the avx2, sse2 or scalar lexer\n"
+		"      --stats            report where time and memory went on stderr\n"
+		"  -t, --throughput       report source throughput on stderr\n"
+		"  -h, --help             show this help\n",
+		stream
+	);
+}
+
+static int parse_jobs(const char *arg, unsigned *jobs)
+{
+	char          *end;
+	unsigned long  cnt = strtoul(arg, &end, 10);
+	if (!*arg || *end || cnt > JOBS_MAX) return -1;
+
+	if (!cnt) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		cnt = (cores > 0) ? (unsigned long) cores : 1;
+	}
+
+	*jobs = cnt;
+
+	return 0;
+}
+
+static void stamp(stamp_t *now)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now->wall = ts.tv_sec + ts.tv_nsec / 1e9;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	now->cpu = ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report_phase(FILE *stream, const char *name, double wall, double cpu)
+{
+	fprintf(stream, "javk-as: %-6s %12.6f %12.6f\n", name, wall, cpu);
+}
+
+static void report(FILE *stream, const stamp_t *stamps)
+{
+	static const char *const phases[] = {
+		[JAVK_AS_PHASE_SCAN]  = "scan",
+		[JAVK_AS_PHASE_PARSE] = "parse",
+		[JAVK_AS_PHASE_LINK]  = "link",
+	};
+
+	javk_as_stats_t stats;
+	struct rusage   usage;
+
+	javk_as_stats(as, &stats);
+	getrusage(RUSAGE_SELF, &usage);
+
+	// stamps mark the start, the end of init, and either side of emit
+	fprintf(stream, "javk-as: %-6s %12s %12s\n", "phase", "wall (s)", "cpu (s)");
+	report_phase(
+		stream,
+		"init",
+		stamps[1].wall - stamps[0].wall,
+		stamps[1].cpu - stamps[0].cpu
+	);
+	for (size_t i = 0; i < JAVK_AS_PHASE_CNT; i++)
+		report_phase(stream, phases[i], stats.wall[i], stats.cpu[i]);
+	report_phase(
+		stream,
+		"emit",
+		stamps[3].wall - stamps[2].wall,
+		stamps[3].cpu - stamps[2].cpu
+	);
+
+	fprintf(
+		stream,
+		"javk-as: %zu sections, %zu instructions\n"
+		"javk-as: %" PRIu64 " section_realloc() calls\n"
+		"javk-as: %" PRIu64 " ht rehashes, %" PRIu64 " lookups, %" PRIu64 " probes"
+		" (%.2f per lookup)\n"
+		"javk-as: %ld KiB peak memory\n",
+		stats.sections,
+		stats.instructions,
+		stats.section_reallocs,
+		stats.ht_rehashes,
+		stats.ht_lookups,
+		stats.ht_probes,
+		(stats.ht_lookups) ? (double) stats.ht_probes / stats.ht_lookups : 0.0,
+		usage.ru_maxrss
+	);
+
+	// only a tracking build has anything to say
+	javk_as_memory_report(stream);
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+	static const struct option longopts[] = {
+		{"cache-dir",  required_argument, NULL, 'C'},
+		{"help",       no_argument,       NULL, 'h'},
+		{"jobs",       required_argument, NULL, 'j'},
+		{"lexer",      required_argument, NULL, 'L'},
+		{"optimize",   no_argument,       NULL, 'O'},
+		{"output",     required_argument, NULL, 'o'},
+		{"stats",      no_argument,       NULL, 'S'},
+		{"throughput", no_argument,       NULL, 't'},
+		{NULL,         0,                 NULL,  0 },
+	};
+
 	static int ret;
 
+	const char *cachedir   = NULL;
+	const char *inpath     = "-";
+	const char *lexer      = NULL;
+	const char *outpath    = "a.out";
+	bool        optimize   = false;
+	bool        stats      = false;
+	bool        throughput = false;
+	unsigned    jobs       = 1;
+	stamp_t     stamps[4];
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "hj:Oo:t", longopts, NULL)) != -1) {
+		switch (opt) {
+			case 'C':
+				cachedir = optarg;
+				break;
+
+			case 'h':
+				usage(stdout);
+				return EXIT_SUCCESS;
+
+			case 'j':
+				if (parse_jobs(optarg, &jobs) < 0) {
+					fprintf(stderr, "%s: invalid job count\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 'L':
+				lexer = optarg;
+				break;
+
+			case 'O':
+				optimize = true;
+				break;
+
+			case 'o':
+				outpath = optarg;
+				break;
+
+			case 'S':
+				stats = true;
+				break;
+
+			case 't':
+				throughput = true;
+				break;
+
+			default:
+				usage(stderr);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind > 1) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+	if (optind < argc) inpath = argv[optind];
+
+	stamp(stamps);
+
 	ret = atexit(cleanexit);
 	if (ret < 0) goto error;
 
-	ret = parser_init();
-	if (ret < 0) goto error;
+	as = javk_as_alloc();
+	if (!as) goto error;
+
+	javk_as_jobs(as, jobs);
+	javk_as_optimize(as, optimize);
+
+	if (lexer && !javk_as_lexer(as, lexer)) {
+		fprintf(stderr, "%s: unsupported lexer\n", lexer);
+		return EXIT_FAILURE;
+	}
+
+	if (cachedir && javk_as_cache_dir(as, cachedir) < 0) goto error;
+
+	in = input_open(inpath);
+	if (!in) {
+		perror(inpath);
+		goto error;
+	}
+
+	stamp(stamps + 1);
+
+	ret = javk_as_assemble(as, in->buf, in->len);
+	if (ret < 0) {
+		const char *err = javk_as_strerror(javk_as_error(as));
+
+		if (javk_as_line(as))
+			fprintf(stderr, "%s:%zu: %s\n", inpath, javk_as_line(as), err);
+		else
+			fprintf(stderr, "%s: %s\n", inpath, err);
+		goto error;
+	}
+
+	stamp(stamps + 2);
+
+	int out = open(outpath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (out < 0) {
+		perror(outpath);
+		goto error;
+	}
+
+	ret = javk_as_write(as, out);
+	if (close(out) || ret < 0) {
+		perror(outpath);
+		goto error;
+	}
+
+	stamp(stamps + 3);
+
+	if (stats) report(stderr, stamps);
+
+	if (throughput) {
+		double secs = stamps[3].wall - stamps[0].wall;
+
+		fprintf(
+			stderr,
+			"javk-as: %zu bytes in %.6f s (%.2f MB/s)\n",
+			in->len,
+			secs,
+			(secs > 0) ? in->len / secs / 1e6 : 0.0
+		);
+	}
 
 	return EXIT_SUCCESS;
 
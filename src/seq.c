@@ -0,0 +1,163 @@
+/*
+ * seq.c -- chunked sequence
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "seq.h"
+#include "seq_private.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "arena.h"
+
+
+seq_t *seq_alloc(arena_t *arena)
+{
+	seq_t *tmp = alloc_calloc(1, sizeof(seq_t));
+	if (!tmp) return NULL;
+
+	tmp->arena = arena;
+
+	return tmp;
+}
+
+size_t seq_append(seq_t *seq, void *data)
+{
+	seq_chunk_t *chunk = seq->tail;
+
+	if (!chunk || chunk->tail == SEQ_CHUNKSIZ) {
+		chunk = chunk_alloc(seq, 0);
+		if (!chunk) return 0;
+
+		if (seq->tail) {
+			seq->tail->next = chunk;
+			chunk->prev = seq->tail;
+			seq->tail = chunk;
+		} else {
+			seq->tail = seq->head = chunk;
+		}
+	}
+
+	chunk->data[chunk->tail++] = data;
+
+	return ++seq->size;
+}
+
+void seq_clear(seq_t *seq, void (*free_data)(void *ptr))
+{
+	seq_chunk_t *tmp;
+	seq_chunk_t *chunk = seq->head;
+	while (chunk) {
+		tmp   = chunk;
+		chunk = chunk->next;
+
+		if (free_data) {
+			for (unsigned i = tmp->head; i < tmp->tail; i++)
+				if (tmp->data[i]) free_data(tmp->data[i]);
+		}
+
+		if (!seq->arena) alloc_free(tmp);
+	}
+
+	seq->head = NULL;
+	seq->tail = NULL;
+	seq->size = 0;
+}
+
+void seq_free(seq_t *seq, void (*free_data)(void *ptr))
+{
+	if (!seq) return;
+
+	seq_clear(seq, free_data);
+
+	alloc_free(seq);
+}
+
+void seq_iter(const seq_t *seq, seq_iter_t *it)
+{
+	it->chunk = seq->head;
+	it->i     = (seq->head) ? seq->head->head : 0;
+}
+
+void **seq_next(seq_iter_t *it)
+{
+	while (it->chunk && it->i >= it->chunk->tail) {
+		it->chunk = it->chunk->next;
+		if (it->chunk) it->i = it->chunk->head;
+	}
+
+	if (!it->chunk) return NULL;
+
+	return it->chunk->data + it->i++;
+}
+
+size_t seq_prepend(seq_t *seq, void *data)
+{
+	seq_chunk_t *chunk = seq->head;
+
+	if (!chunk || !chunk->head) {
+		chunk = chunk_alloc(seq, SEQ_CHUNKSIZ);
+		if (!chunk) return 0;
+
+		if (seq->head) {
+			seq->head->prev = chunk;
+			chunk->next = seq->head;
+			seq->head = chunk;
+		} else {
+			seq->head = seq->tail = chunk;
+		}
+	}
+
+	chunk->data[--chunk->head] = data;
+
+	return ++seq->size;
+}
+
+void **seq_prev(seq_iter_t *it)
+{
+	while (it->chunk && it->i <= it->chunk->head) {
+		it->chunk = it->chunk->prev;
+		if (it->chunk) it->i = it->chunk->tail;
+	}
+
+	if (!it->chunk) return NULL;
+
+	return it->chunk->data + --it->i;
+}
+
+void seq_riter(const seq_t *seq, seq_iter_t *it)
+{
+	it->chunk = seq->tail;
+	it->i     = (seq->tail) ? seq->tail->tail : 0;
+}
+
+
+static seq_chunk_t *chunk_alloc(seq_t *seq, unsigned pos)
+{
+	seq_chunk_t *tmp = (seq->arena)
+		? arena_malloc(seq->arena, sizeof(seq_chunk_t))
+		: alloc_malloc(sizeof(seq_chunk_t));
+	if (!tmp) return NULL;
+
+	tmp->prev = NULL;
+	tmp->next = NULL;
+	tmp->head = pos;
+	tmp->tail = pos;
+
+	return tmp;
+}
@@ -0,0 +1,68 @@
+/*
+ * seq.h -- chunked sequence
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_SEQ
+#define JAVK_AS_SEQ
+
+
+#include <stddef.h>
+
+#include "arena.h"
+
+
+#define SEQ_CHUNKSIZ 61  // fills a 512-byte chunk with 8-byte pointers
+
+
+typedef struct seq_chunk_s {
+	struct seq_chunk_s *prev;
+	struct seq_chunk_s *next;
+	unsigned            head;  // occupied slots are [head, tail)
+	unsigned            tail;
+	void               *data[SEQ_CHUNKSIZ];
+} seq_chunk_t;
+
+_Static_assert(
+	sizeof(void*) != 8 || sizeof(seq_chunk_t) == 512,
+	"SEQ_CHUNKSIZ no longer fills a chunk"
+);
+
+typedef struct seq_s {
+	seq_chunk_t *head;
+	seq_chunk_t *tail;
+	size_t       size;
+	arena_t     *arena;  // backs chunks when set
+} seq_t;
+
+typedef struct seq_iter_s {
+	seq_chunk_t *chunk;
+	unsigned     i;
+} seq_iter_t;
+
+
+seq_t  *seq_alloc(arena_t *arena);
+size_t  seq_append(seq_t *seq, void *data);
+void    seq_clear(seq_t *seq, void (*free_data)(void *ptr));
+void    seq_free(seq_t *seq, void (*free_data)(void *ptr));
+void    seq_iter(const seq_t *seq, seq_iter_t *it);
+void  **seq_next(seq_iter_t *it);
+size_t  seq_prepend(seq_t *seq, void *data);
+void  **seq_prev(seq_iter_t *it);
+void    seq_riter(const seq_t *seq, seq_iter_t *it);
+
+
+#endif /* JAVK_AS_SEQ */
@@ -0,0 +1,190 @@
+/*
+ * javk-sim
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "input.h"
+#include "sim/sim.h"
+
+
+static input_t *in;
+static sim_t   *sim;
+
+
+static void cleanexit(void)
+{
+	input_close(in);
+	sim_free(sim);
+}
+
+static void usage(FILE *stream)
+{
+	fputs(
+		"usage: javk-sim [-pr] [-n limit] [input]\n"
+		"\n"
+		"  -n, --limit N          stop at the first jump after N instructions\n"
+		"  -p, --profile          print how often each address ran on stdout\n"
+		"  -r, --registers        print the registers on exit on stderr\n"
+		"  -h, --help             show this help\n",
+		stream
+	);
+}
+
+static double elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec)
+		+ (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void profile(FILE *stream)
+{
+	char buf[16];
+
+	for (size_t i = 0; i < SIM_MEMSIZ; i++) {
+		if (!sim->count[i]) continue;
+
+		sim_disasm(sim->mem[i], buf, sizeof(buf));
+		fprintf(stream, "%04zx %20" PRIu64 "  %s\n", i, sim->count[i], buf);
+	}
+}
+
+static void registers(FILE *stream)
+{
+	static const char names[] = "abcdefghijklmno";
+
+	for (size_t i = 0; i < sizeof(names) - 1; i++)
+		fprintf(stream, "%c %02x%s", names[i], sim->reg[i], (i % 8 == 7) ? "\n" : "  ");
+
+	fprintf(stream, "pc %04x  sp %04x\n", sim->pc, sim->sp);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option longopts[] = {
+		{"help",      no_argument,       NULL, 'h'},
+		{"limit",     required_argument, NULL, 'n'},
+		{"profile",   no_argument,       NULL, 'p'},
+		{"registers", no_argument,       NULL, 'r'},
+		{NULL,        0,                 NULL,  0 },
+	};
+
+	static const char *const reasons[] = {
+		[SIM_HALT]  = "halted",
+		[SIM_END]   = "ran off the end",
+		[SIM_LIMIT] = "reached the limit",
+	};
+
+	static int ret;
+
+	const char      *inpath = "-";
+	uint64_t         limit  = UINT64_MAX;
+	bool             prof   = false;
+	bool             regs   = false;
+	struct timespec  start;
+	char            *end;
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "hn:pr", longopts, NULL)) != -1) {
+		switch (opt) {
+			case 'h':
+				usage(stdout);
+				return EXIT_SUCCESS;
+
+			case 'n':
+				limit = strtoull(optarg, &end, 10);
+				if (!*optarg || *end) {
+					fprintf(stderr, "%s: invalid limit\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 'p':
+				prof = true;
+				break;
+
+			case 'r':
+				regs = true;
+				break;
+
+			default:
+				usage(stderr);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind > 1) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+	if (optind < argc) inpath = argv[optind];
+
+	ret = atexit(cleanexit);
+	if (ret < 0) goto error;
+
+	sim = sim_alloc();
+	if (!sim) goto error;
+
+	in = input_open(inpath);
+	if (!in) {
+		perror(inpath);
+		goto error;
+	}
+
+	if (sim_load(sim, in->buf, in->len) < 0) {
+		fprintf(stderr, "%s: program must be smaller than 64 KiB\n", inpath);
+		goto error;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	ret = sim_run(sim, limit);
+
+	double secs = elapsed(&start);
+
+	fprintf(
+		stderr,
+		"javk-sim: %s at %04x after %" PRIu64 " instructions, "
+		"%" PRIu64 " cycles in %.6f s (%.2f MIPS)\n",
+		reasons[ret],
+		sim->pc,
+		sim->steps,
+		sim->cycles,
+		secs,
+		(secs > 0) ? sim->steps / secs / 1e6 : 0.0
+	);
+
+	if (regs) registers(stderr);
+	if (prof) profile(stdout);
+
+	return EXIT_SUCCESS;
+
+error:
+	return EXIT_FAILURE;
+}
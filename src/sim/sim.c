@@ -0,0 +1,312 @@
+/*
+ * sim.c -- JAVK instruction-set simulator
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sim/sim.h"
+#include "sim/sim_private.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm/section.h"
+
+
+static const char *const mnemonics[] = {
+	[ADD] = "add",
+	[SUB] = "sub",
+	[NEG] = "neg",
+	[AND] = "and",
+	[ORR] = "orr",
+	[EOR] = "eor",
+	[LSL] = "lsl",
+	[LSR] = "lsr",
+	[MVA] = "mva",
+	[MVB] = "mvb",
+	[LNL] = "lnl",
+	[LNH] = "lnh",
+	[LDB] = "ldb",
+	[STB] = "stb",
+	[JMP] = "jmp",
+	[JPL] = "jpl",
+};
+
+static const char regs_8bit[] = "abcdefghijklmnoz";
+
+static const char *const regs_16bit[] = {
+	[PC] = "pc",
+	[SP] = "sp",
+	[IJ] = "ij",
+	[KL] = "kl",
+};
+
+
+sim_t *sim_alloc(void)
+{
+	return calloc(1, sizeof(sim_t));
+}
+
+int sim_disasm(instruction_t instr, char *buf, size_t siz)
+{
+	unsigned    opcode  = INSTR_OPCODE(instr);
+	unsigned    operand = INSTR_OPERAND(instr);
+	const char *name    = mnemonics[opcode];
+
+	switch (opcode) {
+		case LSL:
+		case LSR:
+		case LNL:
+		case LNH:
+			return snprintf(buf, siz, "%s %u", name, operand);
+
+		case MVB:
+			return snprintf(
+				buf,
+				siz,
+				"%s %s, %s",
+				name,
+				regs_16bit[operand >> 2],
+				regs_16bit[operand & 3]
+			);
+
+		case LDB:
+		case STB:
+		case JMP:
+		case JPL:
+			return snprintf(buf, siz, "%s %s", name, regs_16bit[operand & 3]);
+
+		default:
+			return snprintf(buf, siz, "%s %c", name, regs_8bit[operand]);
+	}
+}
+
+void sim_free(sim_t *sim)
+{
+	free(sim);
+}
+
+int sim_load(sim_t *sim, const void *prog, size_t len)
+{
+	// the address past the image has to exist for control to leave it
+	if (len >= SIM_MEMSIZ) return -1;
+
+	memset(sim, 0, sizeof(*sim));
+	memcpy(sim->mem, prog, len);
+	sim->len = len;
+
+	for (size_t i = 0; i < len; i++) sim->op[i] = INSTR_OPCODE(sim->mem[i]);
+	memset(sim->op + len, SIM_OP_END, SIM_MEMSIZ - len);
+
+	return 0;
+}
+
+// labels as values keep each handler's indirect jump its own, which is
+// what lets the branch predictor follow the program
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+int sim_run(sim_t *sim, uint64_t limit)
+{
+	static const void *const dispatch[] = {
+		[ADD]        = &&add,
+		[SUB]        = &&sub,
+		[NEG]        = &&neg,
+		[AND]        = &&and,
+		[ORR]        = &&orr,
+		[EOR]        = &&eor,
+		[LSL]        = &&lsl,
+		[LSR]        = &&lsr,
+		[MVA]        = &&mva,
+		[MVB]        = &&mvb,
+		[LNL]        = &&lnl,
+		[LNH]        = &&lnh,
+		[LDB]        = &&ldb,
+		[STB]        = &&stb,
+		[JMP]        = &&jmp,
+		[JPL]        = &&jpl,
+		[SIM_OP_END] = &&end,
+	};
+
+	uint8_t  *reg    = sim->reg;
+	uint64_t *count  = sim->count;
+	uint64_t  steps  = sim->steps;
+	uint64_t  cycles = sim->cycles;
+	uint16_t  pc     = sim->pc;
+	uint16_t  target;
+	unsigned  n;
+	int       ret;
+
+#define DISPATCH() do {                \
+	n = INSTR_OPERAND(sim->mem[pc]);   \
+	goto *dispatch[sim->op[pc]];       \
+} while (0)
+
+#define NEXT(cost) do {                \
+	count[pc]++;                       \
+	steps++;                           \
+	cycles += (cost);                  \
+	pc++;                              \
+	DISPATCH();                        \
+} while (0)
+
+	DISPATCH();
+
+add:
+	reg[A] += reg[n];
+	NEXT(SIM_CYCLES_ALU);
+
+sub:
+	reg[A] -= reg[n];
+	NEXT(SIM_CYCLES_ALU);
+
+neg:
+	reg[A] = -reg[n];
+	NEXT(SIM_CYCLES_ALU);
+
+and:
+	reg[A] &= reg[n];
+	NEXT(SIM_CYCLES_ALU);
+
+orr:
+	reg[A] |= reg[n];
+	NEXT(SIM_CYCLES_ALU);
+
+eor:
+	reg[A] ^= reg[n];
+	NEXT(SIM_CYCLES_ALU);
+
+lsl:
+	reg[A] = (n < 8) ? reg[A] << n : 0;
+	NEXT(SIM_CYCLES_ALU);
+
+lsr:
+	reg[A] >>= n;
+	NEXT(SIM_CYCLES_ALU);
+
+mva:
+	reg[n] = reg[A];
+	reg[Z] = 0;
+	NEXT(SIM_CYCLES_ALU);
+
+mvb:
+	target = pair(sim, pc, n & 3);
+	if (n >> 2 == PC) goto jump;
+
+	set_pair(sim, n >> 2, target);
+	NEXT(SIM_CYCLES_ALU);
+
+lnl:
+	reg[A] = (reg[A] & 0xf0) | n;
+	NEXT(SIM_CYCLES_ALU);
+
+lnh:
+	reg[A] = (reg[A] & 0x0f) | n << 4;
+	NEXT(SIM_CYCLES_ALU);
+
+ldb:
+	reg[A] = sim->mem[pair(sim, pc, n & 3)];
+	NEXT(SIM_CYCLES_MEM);
+
+stb:
+	target = pair(sim, pc, n & 3);
+	sim->mem[target] = reg[A];
+	// self-modifying code is decoded again as it is written
+	if (target < sim->len) sim->op[target] = INSTR_OPCODE(reg[A]);
+	NEXT(SIM_CYCLES_MEM);
+
+jpl:
+	target = pair(sim, pc, n & 3);
+	set_pair(sim, KL, pc + 1);
+	goto jump;
+
+jmp:
+	target = pair(sim, pc, n & 3);
+
+jump:
+	count[pc]++;
+	steps++;
+	cycles += SIM_CYCLES_JUMP;
+
+	if (target == pc) {
+		ret = SIM_HALT;
+		goto done;
+	}
+
+	pc = target;
+
+	// straight-line code can't run for long, so the limit only needs
+	// checking where control flow can loop
+	if (steps >= limit) {
+		ret = SIM_LIMIT;
+		goto done;
+	}
+
+	DISPATCH();
+
+end:
+	ret = SIM_END;
+
+#undef NEXT
+#undef DISPATCH
+
+done:
+	sim->pc     = pc;
+	sim->steps  = steps;
+	sim->cycles = cycles;
+
+	return ret;
+}
+
+#pragma GCC diagnostic pop
+
+
+static inline uint16_t pair(const sim_t *sim, uint16_t pc, unsigned n)
+{
+	switch (n) {
+		case PC:
+			return pc;
+
+		case SP:
+			return sim->sp;
+
+		case IJ:
+			return sim->reg[I] << 8 | sim->reg[J];
+
+		default:
+			return sim->reg[K] << 8 | sim->reg[L];
+	}
+}
+
+static inline void set_pair(sim_t *sim, unsigned n, uint16_t val)
+{
+	switch (n) {
+		case SP:
+			sim->sp = val;
+			break;
+
+		case IJ:
+			sim->reg[I] = val >> 8;
+			sim->reg[J] = val;
+			break;
+
+		case KL:
+			sim->reg[K] = val >> 8;
+			sim->reg[L] = val;
+			break;
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ * sim.h -- JAVK instruction-set simulator
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_SIM_SIM
+#define JAVK_AS_SIM_SIM
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm/section.h"
+
+
+// the 16-bit address space
+#define SIM_MEMSIZ (1 << 16)
+
+enum sim_exit {
+	SIM_HALT,   // a jump to its own address
+	SIM_END,    // control left the program
+	SIM_LIMIT,  // the instruction limit was reached
+};
+
+typedef struct sim_s {
+	uint8_t  reg[16];            // 8-bit registers, reg[Z] always reads 0
+	uint16_t pc;
+	uint16_t sp;
+	uint64_t steps;              // instructions executed
+	uint64_t cycles;
+	size_t   len;                // size of the program image
+	uint64_t count[SIM_MEMSIZ];  // times each address was executed
+	uint8_t  op[SIM_MEMSIZ];     // decoded opcode, or halt outside the image
+	uint8_t  mem[SIM_MEMSIZ];
+} sim_t;
+
+
+sim_t *sim_alloc(void);
+// writes instr as assembly to buf, returns the length snprintf() would
+int    sim_disasm(instruction_t instr, char *buf, size_t siz);
+void   sim_free(sim_t *sim);
+// places the program at address 0 and resets every register and counter,
+// the image must leave at least the last address free
+int    sim_load(sim_t *sim, const void *prog, size_t len);
+// runs from pc until a jump halts or once limit instructions have passed
+int    sim_run(sim_t *sim, uint64_t limit);
+
+
+#endif /* JAVK_AS_SIM_SIM */
@@ -0,0 +1,41 @@
+/*
+ * sim_private.h -- JAVK instruction-set simulator
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_SIM_SIM_PRIVATE
+#define JAVK_AS_SIM_SIM_PRIVATE
+
+
+#include "sim/sim.h"
+
+#include <stdint.h>
+
+
+// cycles per opcode, memory accesses and jumps take a second cycle
+#define SIM_CYCLES_ALU  1
+#define SIM_CYCLES_MEM  2
+#define SIM_CYCLES_JUMP 2
+
+// decoded opcode of every address outside the program image
+#define SIM_OP_END 16
+
+
+static inline uint16_t pair(const sim_t *sim, uint16_t pc, unsigned n);
+static inline void     set_pair(sim_t *sim, unsigned n, uint16_t val);
+
+
+#endif /* JAVK_AS_SIM_SIM_PRIVATE */
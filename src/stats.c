@@ -0,0 +1,58 @@
+/*
+ * stats.c -- per-thread counters
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <string.h>
+#include <time.h>
+
+
+_Thread_local stats_t stats_thread STATS_TLS;
+
+
+void stats_add(stats_t *dst, const stats_t *src)
+{
+	dst->section_reallocs += src->section_reallocs;
+	dst->ht_rehashes      += src->ht_rehashes;
+	dst->ht_lookups       += src->ht_lookups;
+	dst->ht_probes        += src->ht_probes;
+}
+
+void stats_clock(stats_clock_t *clk)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	clk->wall = ts.tv_sec + ts.tv_nsec / 1e9;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	clk->cpu = ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void stats_reset(void)
+{
+	memset(&stats_thread, 0, sizeof(stats_thread));
+}
+
+void stats_take(stats_t *dst)
+{
+	stats_add(dst, &stats_thread);
+	stats_reset();
+}
@@ -0,0 +1,59 @@
+/*
+ * stats.h -- per-thread counters
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef JAVK_AS_STATS
+#define JAVK_AS_STATS
+
+
+#include <stdint.h>
+
+
+// the counters sit in static TLS, so bumping one is a single add rather
+// than a call into the dynamic linker
+#if defined(__GNUC__)
+#define STATS_TLS __attribute__((tls_model("initial-exec")))
+#else
+#define STATS_TLS
+#endif
+
+
+// counted by whichever thread does the work, cheap enough to leave on
+typedef struct stats_s {
+	uint64_t section_reallocs;
+	uint64_t ht_rehashes;
+	uint64_t ht_lookups;
+	uint64_t ht_probes;         // control groups scanned by lookups
+} stats_t;
+
+typedef struct stats_clock_s {
+	double wall;  // monotonic seconds
+	double cpu;   // seconds spent by every thread of the process
+} stats_clock_t;
+
+
+extern _Thread_local stats_t stats_thread STATS_TLS;
+
+
+void stats_add(stats_t *dst, const stats_t *src);
+void stats_clock(stats_clock_t *clk);
+void stats_reset(void);
+// moves the counters of the calling thread into dst
+void stats_take(stats_t *dst);
+
+
+#endif /* JAVK_AS_STATS */
@@ -0,0 +1,430 @@
+/*
+ * equiv.c -- assembled programs against a model of their source
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "asm/section.h"
+#include "javk-as.h"
+#include "sim/sim.h"
+
+
+#define EQUIV_SECTIONS   48
+#define EQUIV_STATEMENTS 12   // most per section
+#define EQUIV_ROUNDS     3    // assemblies of each program, edited in between
+#define EQUIV_STEPS      (1 << 20)
+
+// statements besides the ALU opcodes of section.h
+#define EQUIV_LDI 16
+#define EQUIV_LDA 17
+#define EQUIV_NOP 18
+
+
+static const char *const mnemonics[] = {
+	[ADD]       = "ADD",
+	[SUB]       = "SUB",
+	[NEG]       = "NEG",
+	[AND]       = "AND",
+	[ORR]       = "ORR",
+	[EOR]       = "EOR",
+	[LSL]       = "LSL",
+	[LSR]       = "LSR",
+	[JMP]       = "JMP",
+	[JPL]       = "JPL",
+	[EQUIV_LDI] = "LDI",
+	[EQUIV_LDA] = "LDA",
+	[EQUIV_NOP] = "NOP",
+};
+
+static const char regs[] = "ABCDEFGHIJKLMNOZ";
+
+typedef struct stmt_s {
+	unsigned op;
+	unsigned arg;  // register, shift or immediate
+} stmt_t;
+
+typedef struct sec_s {
+	stmt_t stmt[EQUIV_STATEMENTS];
+	size_t cnt;
+	int    jump;    // JMP, JPL or -1 to fall through
+	size_t target;  // always a later section, so every program ends
+} sec_t;
+
+typedef struct prog_s {
+	sec_t  sec[EQUIV_SECTIONS];
+	size_t cnt;
+	size_t addr[EQUIV_SECTIONS + 1];  // of each label, then the end
+} prog_t;
+
+static uint64_t state;
+static size_t   pad;
+static prog_t   prog;
+static uint8_t  out[SIM_MEMSIZ];
+static uint8_t  ref[SIM_MEMSIZ];
+
+
+// splitmix64, fixed so a seed always gives the same programs
+static uint64_t next(void)
+{
+	uint64_t z = (state += UINT64_C(0x9e3779b97f4a7c15));
+
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+	return z ^ (z >> 31);
+}
+
+static size_t below(size_t n)
+{
+	return next() % n;
+}
+
+static void generate(size_t k)
+{
+	static const unsigned alu[] = {ADD, SUB, NEG, AND, ORR, EOR};
+
+	sec_t *sec = prog.sec + k;
+
+	sec->cnt = below(EQUIV_STATEMENTS + 1);
+	for (size_t i = 0; i < sec->cnt; i++) {
+		stmt_t   *stmt = sec->stmt + i;
+		unsigned  pick = below(100);
+
+		if (pick < 40) {
+			stmt->op  = alu[below(6)];
+			stmt->arg = below(16);
+		} else if (pick < 60) {
+			stmt->op  = below(2) ? LSL : LSR;
+			stmt->arg = below(8);
+		} else if (pick < 80) {
+			stmt->op  = EQUIV_LDI;
+			stmt->arg = below(256);
+		} else if (pick < 90) {
+			stmt->op  = EQUIV_LDA;
+			stmt->arg = below(16);
+		} else {
+			stmt->op  = EQUIV_NOP;
+		}
+	}
+
+	sec->jump = -1;
+	if (k + 1 < prog.cnt && below(2)) {
+		sec->jump   = below(2) ? JMP : JPL;
+		sec->target = k + 1 + below(prog.cnt - k - 1);
+	}
+}
+
+static void write_section(FILE *stream, size_t k)
+{
+	const sec_t *sec = prog.sec + k;
+
+	fprintf(stream, "sec%zu:\n", k);
+
+	for (size_t i = 0; i < sec->cnt; i++) {
+		const stmt_t *stmt = sec->stmt + i;
+
+		switch (stmt->op) {
+			case LSL:
+			case LSR:
+			case EQUIV_LDI:
+				fprintf(stream, "\t%s %u\n", mnemonics[stmt->op], stmt->arg);
+				break;
+
+			case EQUIV_NOP:
+				fprintf(stream, "\t%s\n", mnemonics[stmt->op]);
+				break;
+
+			default:
+				fprintf(stream, "\t%s %c\n", mnemonics[stmt->op], regs[stmt->arg]);
+				break;
+		}
+	}
+
+	if (sec->jump >= 0)
+		fprintf(stream, "\t%s sec%zu\n", mnemonics[sec->jump], sec->target);
+
+	// enough padding spreads a program over several jobs
+	if (pad) fprintf(stream, "\t; %0*d\n", (int) pad, 0);
+}
+
+static char *write_source(size_t *len)
+{
+	char *buf;
+	FILE *stream = open_memstream(&buf, len);
+	if (!stream) return NULL;
+
+	for (size_t k = 0; k < prog.cnt; k++) write_section(stream, k);
+
+	if (fclose(stream)) return NULL;
+
+	return buf;
+}
+
+// every label starts what the assembler knows afresh, so a section
+// encodes to the same length alone as it does in the whole program
+static int layout(javk_as_t *as)
+{
+	prog.addr[0] = 0;
+
+	for (size_t k = 0; k < prog.cnt; k++) {
+		char   *buf;
+		size_t  len;
+		FILE   *stream = open_memstream(&buf, &len);
+		if (!stream) return -1;
+
+		write_section(stream, k);
+		if (prog.sec[k].jump >= 0) fprintf(stream, "sec%zu:\n", prog.sec[k].target);
+
+		if (fclose(stream)) return -1;
+
+		int ret = javk_as_assemble(as, buf, len);
+		free(buf);
+		if (ret < 0) return -1;
+
+		prog.addr[k + 1] = prog.addr[k] + javk_as_size(as);
+	}
+
+	return 0;
+}
+
+// what the source says should happen, given where its labels ended up
+static void model(uint8_t *reg, bool *visited)
+{
+	memset(reg, 0, 16);
+	memset(visited, 0, prog.cnt * sizeof(*visited));
+
+	size_t k = 0;
+	while (k < prog.cnt) {
+		const sec_t *sec = prog.sec + k;
+
+		visited[k] = true;
+
+		for (size_t i = 0; i < sec->cnt; i++) {
+			unsigned arg = sec->stmt[i].arg;
+
+			switch (sec->stmt[i].op) {
+				case ADD: reg[A] += reg[arg]; break;
+				case SUB: reg[A] -= reg[arg]; break;
+				case NEG: reg[A] = -reg[arg]; break;
+				case AND: reg[A] &= reg[arg]; break;
+				case ORR: reg[A] |= reg[arg]; break;
+				case EOR: reg[A] ^= reg[arg]; break;
+				case LSL: reg[A] <<= arg; break;
+				case LSR: reg[A] >>= arg; break;
+
+				case EQUIV_LDI: reg[A] = arg; break;
+				case EQUIV_LDA: reg[A] = (arg == A) ? 0 : reg[arg]; break;
+			}
+		}
+
+		if (sec->jump < 0) {
+			++k;
+			continue;
+		}
+
+		// the expansion leaves the low byte of the target in a as well
+		size_t to = prog.addr[sec->target];
+
+		reg[A] = to & 0xff;
+		reg[I] = to >> 8;
+		reg[J] = to & 0xff;
+
+		if (sec->jump == JPL) {
+			reg[K] = prog.addr[k + 1] >> 8;
+			reg[L] = prog.addr[k + 1] & 0xff;
+		}
+
+		k = sec->target;
+	}
+}
+
+static const char *check(sim_t *sim, const uint8_t *bin, size_t len)
+{
+	static const unsigned watched[] = {A, I, J, K, L};
+
+	uint8_t reg[16];
+	bool    visited[EQUIV_SECTIONS];
+
+	if (len != prog.addr[prog.cnt]) return "size differs from its sections";
+
+	model(reg, visited);
+
+	if (sim_load(sim, bin, len) < 0) return "too large to simulate";
+	if (sim_run(sim, EQUIV_STEPS) != SIM_END) return "did not run off the end";
+
+	for (size_t i = 0; i < sizeof(watched) / sizeof(*watched); i++) {
+		if (sim->reg[watched[i]] != reg[watched[i]]) return "registers differ from the model";
+	}
+
+	// a section that encodes to nothing shares its address with the next
+	for (size_t k = 0; k < prog.cnt; k++) {
+		if (prog.addr[k] == prog.addr[k + 1]) continue;
+
+		if ((sim->count[prog.addr[k]] > 0) != visited[k])
+			return "a jump landed somewhere else";
+	}
+
+	return NULL;
+}
+
+static void usage(FILE *stream)
+{
+	fputs(
+		"usage: test-equiv [-Oi] [-j jobs] [-n programs] [-p padding] [-s seed]\n"
+		"\n"
+		"  -O     run the peephole pass\n"
+		"  -i     assemble incrementally\n"
+		"  -j N   jobs to assemble with, checked against one (default: 1)\n"
+		"  -n N   programs to generate (default: 1000)\n"
+		"  -p N   comment bytes after every section (default: 0)\n"
+		"  -s N   random seed (default: 1)\n",
+		stream
+	);
+}
+
+static int parse(const char *arg, unsigned long long max, unsigned long long *val)
+{
+	char *end;
+
+	*val = strtoull(arg, &end, 10);
+
+	return (!*arg || *end || *val > max) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long jobs  = 1;
+	unsigned long long cnt   = 1000;
+	unsigned long long pads  = 0;
+	unsigned long long seed  = 1;
+	bool               opt   = false;
+	bool               incr  = false;
+	int                ret   = 0;
+
+	int o;
+	while ((o = getopt(argc, argv, "Oij:n:p:s:")) != -1) {
+		switch (o) {
+			case 'O':
+				opt = true;
+				break;
+
+			case 'i':
+				incr = true;
+				break;
+
+			case 'j':
+				ret = parse(optarg, 1024, &jobs);
+				break;
+
+			case 'n':
+				ret = parse(optarg, SIZE_MAX, &cnt);
+				break;
+
+			case 'p':
+				ret = parse(optarg, 1 << 20, &pads);
+				break;
+
+			case 's':
+				ret = parse(optarg, UINT64_MAX, &seed);
+				break;
+
+			default:
+				ret = -1;
+				break;
+		}
+
+		if (ret < 0) {
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	state = seed;
+	pad   = pads;
+
+	// one context stays in use across every program, as an editor's would
+	javk_as_t  *as    = javk_as_alloc();
+	javk_as_t  *plain = javk_as_alloc();
+	sim_t      *sim   = sim_alloc();
+	const char *fail  = NULL;
+	size_t      i     = 0;
+	size_t      r     = 0;
+
+	if (!as || !plain || !sim) goto error;
+
+	javk_as_jobs(as, jobs);
+	javk_as_optimize(as, opt);
+	javk_as_optimize(plain, opt);
+	if (incr && javk_as_incremental(as, true) < 0) goto error;
+
+	for (i = 0; i < cnt && !fail; i++) {
+		prog.cnt = 1 + below(EQUIV_SECTIONS);
+		for (size_t k = 0; k < prog.cnt; k++) generate(k);
+
+		for (r = 0; r < EQUIV_ROUNDS && !fail; r++) {
+			// later rounds edit a few sections and assemble again
+			for (size_t e = 0; r && e < 3; e++) generate(below(prog.cnt));
+
+			size_t  len;
+			char   *src = write_source(&len);
+			if (!src) goto error;
+
+			size_t outlen = sizeof(out);
+			size_t reflen = sizeof(ref);
+
+			if (layout(plain) < 0)
+				fail = "a section failed to assemble";
+			else if (javk_as_assemble_to(as, src, len, out, &outlen) < 0)
+				fail = "the program failed to assemble";
+			else if (javk_as_assemble_to(plain, src, len, ref, &reflen) < 0)
+				fail = "the program failed to assemble on one job";
+			else if (outlen != reflen || memcmp(out, ref, outlen))
+				fail = "output differs from one job without caching";
+			else
+				fail = check(sim, out, outlen);
+
+			free(src);
+		}
+	}
+
+	if (fail) fprintf(stderr, "test-equiv: program %zu round %zu: %s\n", i - 1, r - 1, fail);
+
+	sim_free(sim);
+	javk_as_free(plain);
+	javk_as_free(as);
+
+	return (fail) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+error:
+	perror("test-equiv");
+	sim_free(sim);
+	javk_as_free(plain);
+	javk_as_free(as);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,136 @@
+/*
+ * errors.c -- what failing sources report
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "javk-as.h"
+
+
+typedef struct sample_s {
+	const char *text;
+	size_t      line;
+	int         err;
+} sample_t;
+
+static const sample_t samples[] = {
+	{"s:\n\tADD B\n\tADD Q\n",              3, JAVK_AS_ERROR_REGISTER},
+	{"s:\n\tADD IJ\n",                      2, JAVK_AS_ERROR_REGISTER},
+	{"s:\n\tJMP B\n",                       2, JAVK_AS_ERROR_REGISTER},
+	{"s:\n\tLDA Q\n",                       2, JAVK_AS_ERROR_REGISTER},
+	{"s:\n\tLDA KL\n",                      2, JAVK_AS_ERROR_REGISTER},
+	{"s:\n\tNOP\n\tFOO B\n",                3, JAVK_AS_ERROR_MNEMONIC},
+	{"s:\n\tLNL 3\n",                       2, JAVK_AS_ERROR_MNEMONIC},
+	{"s:\n\tADD\n",                         2, JAVK_AS_ERROR_OPERANDS},
+	{"s:\n\tNOP B\n",                       2, JAVK_AS_ERROR_OPERANDS},
+	{"s:\n\tLDA B C\n",                     2, JAVK_AS_ERROR_OPERANDS},
+	{"s:\n\tLDI 0x100\n",                   2, JAVK_AS_ERROR_RANGE},
+	{"s:\n\tLSL 16\n",                      2, JAVK_AS_ERROR_RANGE},
+	{"s:\n\tLDI x\n",                       2, JAVK_AS_ERROR_NUMBER},
+	{":\n",                                 1, JAVK_AS_ERROR_SYNTAX},
+	{"s: x:\n",                             1, JAVK_AS_ERROR_SYNTAX},
+	{"\n\tNOP\ns:\n",                       2, JAVK_AS_ERROR_LEAD},
+	{"s:\n\tNOP\nx:\n\tNOP\ns:\n\tNOP\n",   5, JAVK_AS_ERROR_REDEFINED},
+	{"s:\n\tJMP x\n\tJMP y\nx:\n\tNOP\n",   3, JAVK_AS_ERROR_UNDEFINED},
+	{"s:\n\tNOP\n\n\n\tJPL nowhere\n",      5, JAVK_AS_ERROR_UNDEFINED},
+	{"b:\n\tNOP\n",                         1, JAVK_AS_ERROR_RESERVED},
+	{"s:\n\tNOP\nij:\n\tJMP ij\n",          3, JAVK_AS_ERROR_RESERVED},
+	{"s:\n\tJMP Sp\nSp: NOP\n",             3, JAVK_AS_ERROR_RESERVED},
+	{"s:\n\tJMP pc\nPC:\n",                 3, JAVK_AS_ERROR_RESERVED},
+};
+
+// labels only spelled close to a register, and registers as jump targets
+static const char *const clean[] = {
+	"ab:\n\tJMP ab\n",
+	"ijk:\n\tJMP ijk\n\tJPL pcs\npcs:\n",
+	"s:\n\tJMP ij\n\tJPL Kl\n",
+	"_b:\n\tJMP _b\n",
+};
+
+
+static const char *check(javk_as_t *as, const sample_t *sample)
+{
+	if (javk_as_assemble(as, sample->text, strlen(sample->text)) == 0)
+		return "assembled";
+	if (javk_as_error(as) != sample->err) return "wrong error";
+	if (javk_as_line(as) != sample->line) return "wrong line";
+
+	return NULL;
+}
+
+int main(void)
+{
+	static const char *const modes[] = {"plain", "-O", "incremental"};
+
+	const char *fail = NULL;
+	javk_as_t  *as   = javk_as_alloc();
+	size_t      mode;
+	size_t      i;
+
+	if (!as) {
+		perror("test-errors");
+		return EXIT_FAILURE;
+	}
+
+	for (mode = 0; mode < sizeof(modes) / sizeof(*modes) && !fail; mode++) {
+		javk_as_optimize(as, mode == 1);
+		if (javk_as_incremental(as, mode == 2) < 0) {
+			perror("test-errors");
+			return EXIT_FAILURE;
+		}
+
+		for (i = 0; i < sizeof(samples) / sizeof(*samples) && !fail; i++) {
+			fail = check(as, samples + i);
+
+			// the second time round comes from the cache
+			if (!fail && mode == 2) fail = check(as, samples + i);
+		}
+	}
+
+	if (fail) {
+		fprintf(
+			stderr,
+			"test-errors: %s: sample %zu: %s, got %s at line %zu\n",
+			modes[mode - 1],
+			i - 1,
+			fail,
+			javk_as_strerror(javk_as_error(as)),
+			javk_as_line(as)
+		);
+	}
+
+	for (i = 0; i < sizeof(clean) / sizeof(*clean) && !fail; i++) {
+		if (javk_as_assemble(as, clean[i], strlen(clean[i])) < 0) {
+			fprintf(
+				stderr,
+				"test-errors: clean sample %zu: %s at line %zu\n",
+				i,
+				javk_as_strerror(javk_as_error(as)),
+				javk_as_line(as)
+			);
+			fail = "";
+		}
+	}
+
+	javk_as_free(as);
+
+	return (fail) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,417 @@
+/*
+ * ht.c -- hash table operations and the invariants behind them
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "ht.h"
+
+
+#define KEYS   5000
+#define WRAPS  200   // shuffled rounds of the wrapping cluster
+
+// as laid down by ht.c
+#define CTRL_EMPTY 0x80
+#define CTRL_H2(hash) ((uint8_t) ((hash) >> 57))
+
+
+static uint32_t keys[KEYS];
+static int      vals[KEYS];
+static bool     live[KEYS];
+
+
+// what lookups rely on, whatever operations came before
+static const char *check(const ht_t *ht)
+{
+	const ht_tab_t *tab  = &ht->tab;
+	size_t          mask = tab->cap - 1;
+	size_t          cnt  = 0;
+
+	for (size_t i = 0; i < HT_GROUP; i++)
+		if (tab->ctrl[tab->cap + i] != tab->ctrl[i]) return "mirror out of step";
+
+	for (size_t i = 0; i < tab->cap; i++) {
+		if (tab->ctrl[i] == CTRL_EMPTY) continue;
+
+		const ht_ent_t *ent  = tab->ent + i;
+		size_t          dist = (i - ent->hash) & mask;
+		size_t          prev = (i - 1) & mask;
+
+		if (tab->ctrl[i] != CTRL_H2(ent->hash)) return "control byte out of step";
+		if (dist > tab->maxdist) return "entry past maxdist";
+
+		// robin hood leaves no gap between an entry and its home, and
+		// nobody ahead of it closer to home than itself less one
+		if (dist) {
+			if (tab->ctrl[prev] == CTRL_EMPTY) return "gap before an entry";
+			if (dist > ((prev - tab->ent[prev].hash) & mask) + 1)
+				return "entry out of robin hood order";
+		}
+
+		++cnt;
+	}
+
+	// entries still waiting to migrate count as well
+	for (size_t i = ht->mig; i < ht->old.cap; i++)
+		if (ht->old.ctrl[i] != CTRL_EMPTY) ++cnt;
+
+	return (cnt == ht->cnt) ? NULL : "count out of step";
+}
+
+static const char *expect(const ht_t *ht)
+{
+	size_t cnt = 0;
+
+	for (size_t i = 0; i < KEYS; i++) {
+		const int *val = ht_get(ht, keys + i, sizeof(*keys));
+
+		if (live[i] && val != vals + i) return "entry went missing";
+		if (!live[i] && val) return "deleted entry came back";
+
+		cnt += live[i];
+	}
+
+	// a key held twice would only show in the count
+	if (cnt != ht->cnt) return "wrong count";
+
+	return check(ht);
+}
+
+// set, update and delete with every lookup checked against live
+static const char *churn(arena_t *arena, ht_hash_t hash, unsigned flags)
+{
+	const char *fail = NULL;
+	ht_t       *ht   = ht_alloc(arena, hash, flags);
+
+	if (!ht) return "out of memory";
+
+	memset(live, 0, sizeof(live));
+
+	for (size_t i = 0; i < KEYS && !fail; i++) {
+		if (ht_set(ht, keys + i, sizeof(*keys), vals + i) < 0) fail = "set failed";
+		live[i] = true;
+
+		if (!fail && !(i % 997)) fail = expect(ht);
+	}
+
+	// updates keep the count, deletes hand back the value
+	for (size_t i = 0; i < KEYS && !fail; i += 3) {
+		if (ht_set(ht, keys + i, sizeof(*keys), vals + i) < 0) fail = "update failed";
+		else if (ht_del(ht, keys + i + 1, sizeof(*keys)) != vals + i + 1)
+			fail = "delete missed";
+		else if (ht_del(ht, keys + i + 1, sizeof(*keys))) fail = "deleted twice";
+
+		live[i + 1] = false;
+	}
+
+	if (!fail) fail = expect(ht);
+
+	ht_clear(ht, NULL);
+	memset(live, 0, sizeof(live));
+	if (!fail) fail = expect(ht);
+
+	ht_free(ht, NULL);
+
+	return fail;
+}
+
+// seeded tables each draw their own seed, and both hashes heed it
+static const char *seeded(void)
+{
+	const char *fail = NULL;
+	ht_t       *a    = ht_alloc(NULL, NULL, HT_SEEDED);
+	ht_t       *b    = ht_alloc(NULL, ht_hash_fnv1a, HT_SEEDED);
+
+	if (!a || !b) fail = "out of memory";
+	else if (a->seed == b->seed) fail = "seeds alike";
+	else if (ht_hash_wy(keys, sizeof(*keys), a->seed)
+		== ht_hash_wy(keys, sizeof(*keys), b->seed)
+	) fail = "wyhash ignores the seed";
+	else if (ht_hash_fnv1a(keys, sizeof(*keys), a->seed)
+		== ht_hash_fnv1a(keys, sizeof(*keys), b->seed)
+	) fail = "fnv1a ignores the seed";
+
+	ht_free(a, NULL);
+	ht_free(b, NULL);
+
+	return fail;
+}
+
+// the published 64-bit FNV-1a test vectors, which an unseeded hash is
+static const char *vectors(void)
+{
+	static const struct {
+		const char *text;
+		uint64_t    hash;
+	} fnv1a[] = {
+		{"",       UINT64_C(0xcbf29ce484222325)},
+		{"a",      UINT64_C(0xaf63dc4c8601ec8c)},
+		{"foobar", UINT64_C(0x85944171f73967e8)},
+	};
+
+	for (size_t i = 0; i < sizeof(fnv1a) / sizeof(*fnv1a); i++) {
+		const char *text = fnv1a[i].text;
+
+		if (ht_hash_fnv1a(text, strlen(text), 0) != fnv1a[i].hash)
+			return "fnv1a off the test vectors";
+	}
+
+	return NULL;
+}
+
+// keys are their own hash, so a test decides where they go
+static uint64_t placed(const void *key, size_t len, uint64_t seed)
+{
+	uint64_t hash;
+
+	(void) len;
+	(void) seed;
+
+	memcpy(&hash, key, sizeof(hash));
+
+	return hash;
+}
+
+static uint64_t next_rand(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+static void shuffle(size_t *order, size_t cnt, uint64_t *state)
+{
+	for (size_t i = cnt - 1; i; i--) {
+		size_t j   = next_rand(state) % (i + 1);
+		size_t tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+}
+
+// backward shift deletion across a cluster running past the last slot
+// into the first ones, mirrored control bytes included
+static const char *wrap(void)
+{
+	static const size_t homes[] = {
+		HT_DEFAULT_CAP - 3,
+		HT_DEFAULT_CAP - 2, HT_DEFAULT_CAP - 2, HT_DEFAULT_CAP - 2,
+		HT_DEFAULT_CAP - 1, HT_DEFAULT_CAP - 1, HT_DEFAULT_CAP - 1,
+		0, 0, 1, 1, 2, 5, HT_GROUP - 1, HT_GROUP,
+	};
+
+	const size_t cnt   = sizeof(homes) / sizeof(*homes);
+	const char  *fail  = NULL;
+	ht_t        *ht    = ht_alloc(NULL, placed, 0);
+	uint64_t     state = 0x9e3779b97f4a7c15;
+	uint64_t     hashes[sizeof(homes) / sizeof(*homes)];
+	size_t       order[sizeof(homes) / sizeof(*homes)];
+
+	if (!ht) return "out of memory";
+
+	// the high bits tell keys with one home apart
+	for (size_t i = 0; i < cnt; i++) hashes[i] = homes[i] | (uint64_t) i << 32;
+
+	for (unsigned round = 0; round < WRAPS && !fail; round++) {
+		for (size_t i = 0; i < cnt; i++) order[i] = i;
+
+		shuffle(order, cnt, &state);
+		for (size_t i = 0; i < cnt && !fail; i++) {
+			size_t k = order[i];
+
+			if (ht_set(ht, hashes + k, sizeof(*hashes), vals + k) < 0)
+				fail = "set failed";
+		}
+
+		if (fail) break;
+		if (ht->tab.ctrl[ht->tab.cap - 1] == CTRL_EMPTY
+			|| ht->tab.ctrl[0] == CTRL_EMPTY
+		) {
+			fail = "cluster does not wrap";
+			break;
+		}
+
+		shuffle(order, cnt, &state);
+		for (size_t i = 0; i < cnt && !fail; i++) {
+			size_t k = order[i];
+
+			if (ht_del(ht, hashes + k, sizeof(*hashes)) != vals + k) {
+				fail = "delete missed";
+				break;
+			}
+
+			// everything not yet deleted is still found
+			for (size_t j = i + 1; j < cnt && !fail; j++) {
+				size_t l = order[j];
+
+				if (ht_get(ht, hashes + l, sizeof(*hashes)) != vals + l)
+					fail = "entry lost in the shift";
+			}
+
+			if (!fail && ht_get(ht, hashes + k, sizeof(*hashes)))
+				fail = "deleted entry came back";
+			if (!fail) fail = check(ht);
+		}
+
+		if (!fail && ht->cnt) fail = "table not empty";
+	}
+
+	ht_free(ht, NULL);
+
+	return fail;
+}
+
+// lookups, updates, inserts and deletes while a resize is under way
+static const char *migration(void)
+{
+	const char *fail = NULL;
+	ht_t       *ht   = ht_alloc(NULL, NULL, HT_INCREMENTAL);
+	size_t      cnt  = 0;
+
+	if (!ht) return "out of memory";
+
+	memset(live, 0, sizeof(live));
+
+	while (!ht->old.cap && cnt < KEYS) {
+		if (ht_set(ht, keys + cnt, sizeof(*keys), vals + cnt) < 0) {
+			fail = "set failed";
+			break;
+		}
+
+		live[cnt++] = true;
+	}
+
+	if (!fail && !ht->old.cap) fail = "never resized";
+
+	// every insert moves a few slots over, so this spans the whole resize
+	while (!fail && ht->old.cap && cnt < KEYS) {
+		if ((fail = expect(ht))) break;
+
+		// update something old still holds, from the end so the slots
+		// moved over on the way in don't take it first
+		size_t i = ht->old.cap;
+		while (i > ht->mig + HT_MIGRATE && ht->old.ctrl[i - 1] == CTRL_EMPTY) i--;
+
+		if (i > ht->mig + HT_MIGRATE) {
+			const uint32_t *key = ht->old.ent[i - 1].key;
+
+			if (ht_set(ht, key, sizeof(*key), vals + *key) < 0) fail = "update failed";
+			else if (ht_get(ht, key, sizeof(*key)) != vals + *key) fail = "update lost";
+		}
+
+		if (!fail && ht_set(ht, keys + cnt, sizeof(*keys), vals + cnt) < 0)
+			fail = "set failed";
+
+		live[cnt++] = true;
+	}
+
+	if (!fail && ht->old.cap) fail = "resize never finished";
+
+	// deleting mid-resize finishes the resize first
+	while (!fail && !ht->old.cap && cnt < KEYS) {
+		if (ht_set(ht, keys + cnt, sizeof(*keys), vals + cnt) < 0) fail = "set failed";
+		live[cnt++] = true;
+	}
+
+	if (!fail && !ht->old.cap) fail = "never resized again";
+
+	if (!fail) {
+		if (ht_del(ht, keys, sizeof(*keys)) != vals) fail = "delete missed";
+		else if (ht->old.cap) fail = "delete left the resize pending";
+
+		live[0] = false;
+	}
+
+	if (!fail) fail = expect(ht);
+
+	ht_free(ht, NULL);
+
+	return fail;
+}
+
+int main(void)
+{
+	const char *fail  = NULL;
+	const char *what  = NULL;
+	arena_t    *arena = arena_alloc();
+
+	if (!arena) {
+		perror("test-ht");
+		return EXIT_FAILURE;
+	}
+
+	for (uint32_t i = 0; i < KEYS; i++) keys[i] = i;
+
+	static const struct {
+		const char *name;
+		bool        arena;
+		ht_hash_t   hash;
+		unsigned    flags;
+	} tables[] = {
+		{"copied",       false, NULL,          0},
+		{"arena",        true,  NULL,          0},
+		{"nocopy",       false, NULL,          HT_NOCOPY},
+		{"incremental",  false, NULL,          HT_INCREMENTAL},
+		{"seeded",       false, NULL,          HT_SEEDED},
+		{"fnv1a",        false, ht_hash_fnv1a, 0},
+		{"fnv1a-seeded", false, ht_hash_fnv1a, HT_SEEDED},
+	};
+
+	for (size_t i = 0; i < sizeof(tables) / sizeof(*tables) && !fail; i++) {
+		what = tables[i].name;
+		fail = churn(
+			(tables[i].arena) ? arena : NULL,
+			tables[i].hash,
+			tables[i].flags
+		);
+	}
+
+	if (!fail) {
+		what = "seeds";
+		fail = seeded();
+	}
+
+	if (!fail) {
+		what = "vectors";
+		fail = vectors();
+	}
+
+	if (!fail) {
+		what = "migration";
+		fail = migration();
+	}
+
+	if (!fail) {
+		what = "wrap";
+		fail = wrap();
+	}
+
+	if (fail) fprintf(stderr, "test-ht: %s: %s\n", what, fail);
+
+	arena_free(arena);
+
+	return (fail) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
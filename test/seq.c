@@ -0,0 +1,130 @@
+/*
+ * seq.c -- sequences grown from both ends and walked both ways
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "seq.h"
+
+
+// enough to span several chunks from either end
+#define ITEMS (SEQ_CHUNKSIZ * 5 + 3)
+
+
+static int    items[ITEMS * 2];
+static size_t freed;
+
+
+static void count_free(void *ptr)
+{
+	(void) ptr;
+
+	++freed;
+}
+
+// items were prepended from ITEMS - 1 down to 0 and appended from ITEMS
+// up, so both walks see them in index order
+static const char *walk(const seq_t *seq, size_t cnt)
+{
+	seq_iter_t   it;
+	void       **data;
+	size_t       i = ITEMS - cnt / 2;
+
+	if (seq->size != cnt) return "wrong size";
+
+	for (const seq_chunk_t *chunk = seq->head; chunk; chunk = chunk->next) {
+		if (chunk->head > chunk->tail || chunk->tail > SEQ_CHUNKSIZ)
+			return "chunk out of bounds";
+		if (chunk->next && chunk->next->prev != chunk) return "chunks mislinked";
+	}
+
+	seq_iter(seq, &it);
+	while ((data = seq_next(&it))) {
+		if (*data != items + i++) return "forward walk out of order";
+	}
+	if (i != ITEMS + cnt / 2) return "forward walk cut short";
+
+	seq_riter(seq, &it);
+	while ((data = seq_prev(&it))) {
+		if (*data != items + --i) return "reverse walk out of order";
+	}
+	if (i != ITEMS - cnt / 2) return "reverse walk cut short";
+
+	// an exhausted iterator stays that way
+	if (seq_prev(&it) || seq_prev(&it)) return "reverse walk went on";
+
+	return NULL;
+}
+
+static const char *run(arena_t *arena)
+{
+	const char *fail = NULL;
+	seq_t      *seq  = seq_alloc(arena);
+
+	if (!seq) return "out of memory";
+
+	// twice, the second time round on a cleared sequence
+	for (unsigned round = 0; round < 2 && !fail; round++) {
+		if ((fail = walk(seq, 0))) break;
+
+		for (size_t i = 0; i < ITEMS && !fail; i++) {
+			if (seq_prepend(seq, items + ITEMS - 1 - i) != 2 * i + 1)
+				fail = "prepend miscounted";
+			else if (seq_append(seq, items + ITEMS + i) != 2 * i + 2)
+				fail = "append miscounted";
+			else if (!(i % 7))
+				fail = walk(seq, 2 * i + 2);
+		}
+
+		if (!fail) fail = walk(seq, 2 * ITEMS);
+
+		freed = 0;
+		seq_clear(seq, count_free);
+		if (!fail && freed != 2 * ITEMS) fail = "clear missed items";
+	}
+
+	seq_free(seq, NULL);
+
+	return fail;
+}
+
+int main(void)
+{
+	const char *fail  = NULL;
+	arena_t    *arena = arena_alloc();
+
+	if (!arena) {
+		perror("test-seq");
+		return EXIT_FAILURE;
+	}
+
+	fail = run(NULL);
+	if (fail) fprintf(stderr, "test-seq: heap: %s\n", fail);
+
+	if (!fail) {
+		fail = run(arena);
+		if (fail) fprintf(stderr, "test-seq: arena: %s\n", fail);
+	}
+
+	arena_free(arena);
+
+	return (fail) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
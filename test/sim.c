@@ -0,0 +1,76 @@
+/*
+ * sim.c -- loading images up to the edge of the address space
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm/section.h"
+#include "sim/sim.h"
+
+
+static instruction_t prog[SIM_MEMSIZ];
+
+
+// a full image leaves no address past it, pc would wrap to 0 and the
+// program would never end
+static const char *full(sim_t *sim)
+{
+	if (sim_load(sim, prog, SIM_MEMSIZ) == 0) return "full image loaded";
+
+	return NULL;
+}
+
+// one short of full, straight-line code runs into the last address
+static const char *largest(sim_t *sim)
+{
+	if (sim_load(sim, prog, SIM_MEMSIZ - 1) < 0) return "largest image refused";
+
+	if (sim_run(sim, 1) != SIM_END) return "did not run off the end";
+	if (sim->pc != SIM_MEMSIZ - 1) return "ended at the wrong address";
+	if (sim->steps != SIM_MEMSIZ - 1) return "wrong step count";
+
+	return NULL;
+}
+
+int main(void)
+{
+	const char *fail = NULL;
+	sim_t      *sim  = sim_alloc();
+
+	if (!sim) {
+		perror("test-sim");
+		return EXIT_FAILURE;
+	}
+
+	// ORR Z is how a NOP is spelt
+	for (size_t i = 0; i < SIM_MEMSIZ; i++) prog[i] = INSTR(ORR, Z);
+
+	fail = full(sim);
+	if (fail) fprintf(stderr, "test-sim: full: %s\n", fail);
+
+	if (!fail) {
+		fail = largest(sim);
+		if (fail) fprintf(stderr, "test-sim: largest: %s\n", fail);
+	}
+
+	sim_free(sim);
+
+	return (fail) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,276 @@
+/*
+ * store.c -- section store round trips and damaged entries
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "asm/lexer.h"
+#include "asm/parser.h"
+#include "asm/store.h"
+#include "asm/unit.h"
+
+
+#define STORE_ENTRYMAX 4096
+
+
+typedef struct sample_s {
+	const char *text;
+	bool        cont;  // may open with instructions before any label
+} sample_t;
+
+static const sample_t samples[] = {
+	{"start:\n\tLDI 3\n\tJMP start\n", false},
+	{
+		"one:\n\tLDA B\n\tJPL two\n\tLSL 2\n"
+		"two:\n\tLDI 0x30\n\tJMP one\n\tJMP three\n"
+		"three:\n\tNEG A\n",
+		false,
+	},
+	{"\tADD C\n\tJMP after\nafter:\n\tLDI 7\n\tJMP after\n", true},
+	{"empty:\nlast:\n\tJMP empty\n", false},
+};
+
+static char    dir[] = "test-store-XXXXXX";
+static char    entry[sizeof(dir) + 4 + sizeof(((struct dirent *) 0)->d_name)];
+static uint8_t saved[STORE_ENTRYMAX];
+static size_t  saved_len;
+
+
+// the store fans entries out over directories, each test leaves one
+static int find_entry(void)
+{
+	DIR *top = opendir(dir);
+	if (!top) return -1;
+
+	struct dirent *ent;
+	int            ret = -1;
+
+	while ((ent = readdir(top))) {
+		if (ent->d_name[0] == '.') continue;
+
+		char sub[sizeof(dir) + 3];
+		snprintf(sub, sizeof(sub), "%s/%.2s", dir, ent->d_name);
+
+		DIR *fan = opendir(sub);
+		if (!fan) break;
+
+		while ((ent = readdir(fan))) {
+			if (ent->d_name[0] == '.') continue;
+
+			snprintf(entry, sizeof(entry), "%s/%s", sub, ent->d_name);
+			ret = 0;
+			break;
+		}
+
+		closedir(fan);
+		break;
+	}
+
+	closedir(top);
+
+	return ret;
+}
+
+static void remove_entry(void)
+{
+	unlink(entry);
+
+	*strrchr(entry, '/') = '\0';
+	rmdir(entry);
+}
+
+static int write_entry(const uint8_t *buf, size_t len)
+{
+	FILE *stream = fopen(entry, "wb");
+	if (!stream) return -1;
+
+	size_t ret = fwrite(buf, 1, len, stream);
+
+	return (fclose(stream) || ret != len) ? -1 : 0;
+}
+
+static bool same(const unit_t *x, const unit_t *y)
+{
+	if (x->stream->cnt != y->stream->cnt
+		|| memcmp(x->stream->instr, y->stream->instr, x->stream->cnt)
+		|| x->defs_cnt != y->defs_cnt
+		|| x->refs_cnt != y->refs_cnt
+		|| x->lead != y->lead
+		|| x->line != y->line
+	) return false;
+
+	// names are pushed in another order on the way back
+	for (size_t i = 0; i < x->defs_cnt; i++) {
+		const unit_def_t *a = x->defs + i;
+		const unit_def_t *b = y->defs + i;
+
+		if (a->off != b->off || a->line != b->line) return false;
+		if (strcmp(x->names + a->name, y->names + b->name)) return false;
+	}
+
+	for (size_t i = 0; i < x->refs_cnt; i++) {
+		const unit_ref_t *a = x->refs + i;
+		const unit_ref_t *b = y->refs + i;
+
+		if (a->off != b->off || a->line != b->line) return false;
+		if (strcmp(x->names + a->name, y->names + b->name)) return false;
+	}
+
+	return true;
+}
+
+// what linking relies on, whatever an entry claimed
+static bool sound(const unit_t *unit)
+{
+	size_t cnt   = unit->stream->cnt;
+	size_t start = (unit->defs_cnt) ? unit->defs[0].off : cnt;
+
+	if (unit->lead > start) return false;
+
+	for (size_t i = 0; i < unit->defs_cnt; i++) {
+		if (unit->defs[i].off > cnt) return false;
+		if (i && unit->defs[i].off < unit->defs[i - 1].off) return false;
+	}
+
+	for (size_t i = 0; i < unit->refs_cnt; i++) {
+		if (cnt < JUMP_LEN || unit->refs[i].off > cnt - JUMP_LEN) return false;
+	}
+
+	return true;
+}
+
+static const char *damage(const sample_t *sample, unit_t *unit, parser_t *parser)
+{
+	const char *text = sample->text;
+	size_t      len  = strlen(text);
+	size_t      line;
+
+	// text stored in an entry decides whether it is a hit at all
+	const uint8_t *pos = NULL;
+	for (size_t i = 0; i + len <= saved_len && !pos; i++)
+		if (!memcmp(saved + i, text, len)) pos = saved + i;
+	if (!pos) return "entry does not hold its text";
+
+	for (size_t i = 0; i < saved_len; i++) {
+		if (write_entry(saved, i) < 0) return "cannot write the entry";
+		if (!store_get(dir, text, len, 0, unit)) return "truncated entry was a hit";
+	}
+
+	static const uint8_t flips[] = {0x01, 0x10, 0x80, 0xff};
+
+	for (size_t i = 0; i < saved_len; i++) {
+		for (size_t f = 0; f < sizeof(flips); f++) {
+			uint8_t buf[STORE_ENTRYMAX];
+
+			memcpy(buf, saved, saved_len);
+			buf[i] ^= flips[f];
+
+			if (write_entry(buf, saved_len) < 0) return "cannot write the entry";
+			if (store_get(dir, text, len, 0, unit) < 0) continue;
+
+			if (saved + i >= pos && saved + i < pos + len)
+				return "entry with other text was a hit";
+			if (!sound(unit)) return "damaged entry was a hit";
+
+			// patching has to stay inside the stream
+			parser_reset(parser);
+			parser_link(parser, unit, &line);
+		}
+	}
+
+	return (write_entry(saved, saved_len) < 0) ? "cannot write the entry" : NULL;
+}
+
+static const char *round_trip(const sample_t *sample, lexer_t *lexer, parser_t *parser)
+{
+	const char *text = sample->text;
+	size_t      len  = strlen(text);
+	const char *fail = NULL;
+	unit_t     *put  = unit_alloc(sample->cont, UNIT_SECSIZ);
+	unit_t     *get  = unit_alloc(sample->cont, UNIT_SECSIZ);
+
+	if (!put || !get) {
+		fail = "out of memory";
+		goto done;
+	}
+
+	if (lex(lexer, put, text, len) < 0) {
+		fail = "sample failed to assemble";
+		goto done;
+	}
+
+	if (store_get(dir, text, len, 0, get) == 0) fail = "empty store had an entry";
+	else if (store_put(dir, text, len, 0, put) < 0) fail = "cannot add an entry";
+	else if (find_entry() < 0) fail = "entry went missing";
+	else if (store_get(dir, text, len, 1, get) == 0) fail = "-O shared an entry";
+	else if (store_get(dir, text, len, 0, get) < 0) fail = "entry was a miss";
+	else if (!same(put, get)) fail = "entry came back different";
+
+	if (fail) goto done;
+
+	FILE *stream = fopen(entry, "rb");
+	if (!stream) {
+		fail = "cannot read the entry";
+		goto done;
+	}
+
+	saved_len = fread(saved, 1, sizeof(saved), stream);
+	fclose(stream);
+
+	fail = damage(sample, get, parser);
+
+done:
+	if (*entry) remove_entry();
+	*entry = '\0';
+
+	unit_free(get);
+	unit_free(put);
+
+	return fail;
+}
+
+int main(void)
+{
+	const char *fail   = NULL;
+	lexer_t    *lexer  = lexer_alloc();
+	parser_t   *parser = parser_alloc();
+
+	if (!lexer || !parser || !mkdtemp(dir)) {
+		perror("test-store");
+		return EXIT_FAILURE;
+	}
+
+	size_t i;
+	for (i = 0; i < sizeof(samples) / sizeof(*samples) && !fail; i++)
+		fail = round_trip(samples + i, lexer, parser);
+
+	if (fail) fprintf(stderr, "test-store: sample %zu: %s\n", i - 1, fail);
+
+	rmdir(dir);
+	parser_free(parser);
+	lexer_free(lexer);
+
+	return (fail) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/*
+ * superopt.c -- both sides of every generated rewrite, run and compared
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asm/section.h"
+#include "asm/superopt.h"
+#include "asm/superopt_table.h"
+#include "sim/sim.h"
+
+
+// javk-superopt and javk-sim each carry the semantics of the accumulator
+// instructions, running both sides of every rewrite keeps them in step
+static uint8_t run(sim_t *sim, size_t at, uint8_t acc)
+{
+	sim->pc     = at;
+	sim->reg[A] = acc;
+
+	sim_run(sim, UINT64_MAX);
+
+	return sim->reg[A];
+}
+
+static void print(FILE *stream, uint64_t word, size_t len)
+{
+	instruction_t instr[SUPEROPT_MAXLEN];
+	char          buf[32];
+
+	superopt_unpack(word, len, instr);
+
+	for (size_t i = 0; i < len; i++) {
+		sim_disasm(instr[i], buf, sizeof(buf));
+		fprintf(stream, "%s%s", (i) ? "; " : "", buf);
+	}
+}
+
+// checks the rules from first up to last, laid out in the loaded image
+static int check(sim_t *sim, size_t first, size_t last)
+{
+	size_t at = 0;
+
+	for (size_t i = first; i < last; i++) {
+		const superopt_t *ent = superopt_table + i;
+		size_t            win = at;
+		size_t            rep = at + ent->len + 1;
+
+		at = rep + ent->rlen + 1;
+
+		for (unsigned acc = 0; acc < 256; acc++) {
+			if (run(sim, win, acc) == run(sim, rep, acc)) continue;
+
+			fputs("test-superopt: ", stderr);
+			print(stderr, ent->key, ent->len);
+			fputs(" -> ", stderr);
+			print(stderr, ent->rep, ent->rlen);
+			fprintf(stderr, " differs for a = 0x%02x\n", acc);
+
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	static instruction_t prog[SIM_MEMSIZ];
+
+	sim_t *sim = sim_alloc();
+	if (!sim) {
+		perror("test-superopt");
+		return EXIT_FAILURE;
+	}
+
+	int    ret   = EXIT_SUCCESS;
+	size_t first = 0;
+	size_t len   = 0;
+
+	// both sides of a rule end in a jump to itself, which halts
+	for (size_t i = 0; i < SUPEROPT_TABLE_CNT && ret == EXIT_SUCCESS; i++) {
+		const superopt_t *ent = superopt_table + i;
+
+		superopt_unpack(ent->key, ent->len, prog + len);
+		len += ent->len;
+		prog[len++] = INSTR(JMP, PC);
+
+		superopt_unpack(ent->rep, ent->rlen, prog + len);
+		len += ent->rlen;
+		prog[len++] = INSTR(JMP, PC);
+
+		if (i + 1 < SUPEROPT_TABLE_CNT && len + 2 * (SUPEROPT_MAXLEN + 1) < SIM_MEMSIZ)
+			continue;
+
+		if (sim_load(sim, prog, len) < 0 || check(sim, first, i + 1) < 0)
+			ret = EXIT_FAILURE;
+
+		first = i + 1;
+		len   = 0;
+	}
+
+	sim_free(sim);
+
+	return ret;
+}